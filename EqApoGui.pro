@@ -8,22 +8,54 @@ msvc*{
 }
 
 SOURCES += \
+	src/BiquadCascade.cpp \
+	src/ConfigDocument.cpp \
+	src/ConfigFileService.cpp \
 	src/EqApoConfig.cpp \
+	src/FileChangeWatcher.cpp \
 	src/Filter.cpp \
+	src/FrequencyResponse.cpp \
 	src/FrequencyResponseWidget.cpp \
+	src/IncludeResolver.cpp \
 	src/MainWindow.cpp \
+	src/PeakingFitter.cpp \
+	src/ProfileCache.cpp \
 	src/ProfileEditorWindow.cpp \
+	src/ProfileListModel.cpp \
+	src/ProfileListView.cpp \
 	src/ProfileParser.cpp \
+	src/ProfileScanner.cpp \
+	src/ProfileThumbnails.cpp \
+	src/RealtimeEngine.cpp \
+	src/UpdateScheduler.cpp \
+	src/WavRenderer.cpp \
 	src/main.cpp
 
 
 HEADERS += \
+	src/BiquadCascade.h \
+	src/ConfigDocument.h \
+	src/ConfigFileService.h \
 	src/EqApoConfig.h \
+	src/FileChangeWatcher.h \
 	src/Filter.h \
+	src/FlushDenormals.h \
 	src/FrequencyResponse.h \
 	src/FrequencyResponseWidget.h \
+	src/IncludeResolver.h \
 	src/MainWindow.h \
+	src/ParallelFor.h \
+	src/PeakingFitter.h \
+	src/ProfileCache.h \
 	src/ProfileEditorWindow.h \
+	src/ProfileListModel.h \
+	src/ProfileListView.h \
 	src/ProfileParser.h \
+	src/ProfileScanner.h \
+	src/ProfileThumbnails.h \
+	src/RealtimeEngine.h \
+	src/SpscQueue.h \
+	src/UpdateScheduler.h \
+	src/WavRenderer.h \
 	src/version.h
 
@@ -0,0 +1,98 @@
+#include "BiquadCascade.h"
+#include "FlushDenormals.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BIQUAD_CASCADE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Every section runs over this many frames before the next one, small enough for the frames to stay in L1
+inline constexpr size_t SubBlockFrames = 256;
+
+} // namespace
+
+BiquadCascade::BiquadCascade(const FilterBank& bank, size_t channelCount) :
+	_gain(std::pow(10.0, bank.gainDb / 20.0)),
+	_channelCount(channelCount)
+{
+	_sections.reserve(bank.size());
+	for (size_t k = 0; k < bank.size(); ++k)
+	{
+		const double a0 = bank.a0[k];
+		_sections.push_back({ bank.b0[k] / a0, bank.b1[k] / a0, bank.b2[k] / a0, bank.a1[k] / a0, bank.a2[k] / a0 });
+	}
+
+	_state.assign(_sections.size() * 2 * channelCount, 0.0);
+}
+
+void BiquadCascade::process(double* samples, size_t frameCount)
+{
+	const size_t channels = _channelCount;
+	if (channels == 0)
+		return;
+
+	const FlushDenormals flushDenormals;
+
+	for (size_t first = 0; first < frameCount; first += SubBlockFrames)
+	{
+		const size_t count = std::min(SubBlockFrames, frameCount - first);
+		double* block = samples + first * channels;
+
+		if (_gain != 1.0)
+		{
+			for (size_t i = 0; i < count * channels; ++i)
+				block[i] *= _gain;
+		}
+
+		for (size_t k = 0; k < _sections.size(); ++k)
+		{
+			const Section& section = _sections[k];
+			double* z1 = _state.data() + k * 2 * channels;
+			double* z2 = z1 + channels;
+
+			size_t c = 0;
+#ifdef BIQUAD_CASCADE_X86_SIMD
+			// Two channels per SSE2 register, which covers stereo without a scalar remainder
+			const __m128d b0 = _mm_set1_pd(section.b0), b1 = _mm_set1_pd(section.b1), b2 = _mm_set1_pd(section.b2);
+			const __m128d a1 = _mm_set1_pd(section.a1), a2 = _mm_set1_pd(section.a2);
+			for (; c + 2 <= channels; c += 2)
+			{
+				__m128d s1 = _mm_loadu_pd(z1 + c);
+				__m128d s2 = _mm_loadu_pd(z2 + c);
+				for (size_t i = 0; i < count; ++i)
+				{
+					double* frame = block + i * channels + c;
+					const __m128d x = _mm_loadu_pd(frame);
+					const __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), s1);
+					s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), s2);
+					s2 = _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y));
+					_mm_storeu_pd(frame, y);
+				}
+				_mm_storeu_pd(z1 + c, s1);
+				_mm_storeu_pd(z2 + c, s2);
+			}
+#endif
+			for (; c < channels; ++c)
+			{
+				double s1 = z1[c];
+				double s2 = z2[c];
+				for (size_t i = 0; i < count; ++i)
+				{
+					double& sample = block[i * channels + c];
+					const double x = sample;
+					const double y = section.b0 * x + s1;
+					s1 = section.b1 * x - section.a1 * y + s2;
+					s2 = section.b2 * x - section.a2 * y;
+					sample = y;
+				}
+				z1[c] = s1;
+				z2[c] = s2;
+			}
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "FrequencyResponse.h"
+
+#include <cstddef>
+#include <vector>
+
+// The biquads of a filter bank applied in series to interleaved multichannel audio, in transposed direct form II.
+// The channels are processed side by side in SIMD lanes, and every section runs over a whole sub-block before
+// the next one so that its coefficients and state stay in registers. The state is kept between calls.
+class BiquadCascade final {
+public:
+	BiquadCascade() = default;
+	BiquadCascade(const FilterBank& bank, size_t channelCount);
+
+	// Filters frameCount interleaved frames in place
+	void process(double* samples, size_t frameCount);
+
+private:
+	// Normalized by a0
+	struct Section {
+		double b0, b1, b2, a1, a2;
+	};
+
+	std::vector<Section> _sections;
+	double _gain = 1.0; // Of the preamps
+	size_t _channelCount = 0;
+	std::vector<double> _state; // For every section, z1 of all the channels followed by z2 of all the channels
+};
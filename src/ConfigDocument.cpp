@@ -0,0 +1,210 @@
+#include "ConfigDocument.h"
+
+#include <array>
+#include <utility>
+
+namespace {
+
+struct Directive {
+	QStringView name;
+	ConfigDocument::LineType type;
+};
+
+constexpr std::array directives{
+	Directive{ u"Preamp", ConfigDocument::LineType::Preamp },
+	Directive{ u"Include", ConfigDocument::LineType::Include },
+	Directive{ u"Device", ConfigDocument::LineType::Device },
+	Directive{ u"Channel", ConfigDocument::LineType::Channel },
+	Directive{ u"Stage", ConfigDocument::LineType::Stage },
+	Directive{ u"If", ConfigDocument::LineType::If },
+	Directive{ u"ElseIf", ConfigDocument::LineType::ElseIf },
+	Directive{ u"Else", ConfigDocument::LineType::Else },
+	Directive{ u"EndIf", ConfigDocument::LineType::EndIf },
+	Directive{ u"Filter", ConfigDocument::LineType::Filter },
+};
+
+// The filters of a profile are often numbered, "Filter 1: ON PK ...", like ProfileParser the number is dropped
+QStringView withoutFilterNumber(QStringView name)
+{
+	qsizetype end = name.size();
+	while (end > 0 && name[end - 1].isDigit())
+		--end;
+
+	if (end == name.size() || end == 0 || !name[end - 1].isSpace())
+		return name;
+
+	return name.first(end).trimmed();
+}
+
+// Skips the whitespace and the byte order mark at the start of the file
+qsizetype contentStart(QStringView text)
+{
+	qsizetype i = 0;
+	while (i < text.size() && (text[i].isSpace() || text[i] == QChar::ByteOrderMark))
+		++i;
+
+	return i;
+}
+
+} // namespace
+
+ConfigDocument::ConfigDocument(QString text) :
+	_source(std::move(text))
+{
+	const QStringView source = _source;
+	bool lineBreakFound = false;
+
+	for (qsizetype offset = 0; offset < source.size();)
+	{
+		qsizetype end = source.indexOf(u'\n', offset);
+		const qsizetype next = end < 0 ? source.size() : end + 1;
+		if (end < 0)
+			end = source.size();
+		if (end > offset && source[end - 1] == u'\r')
+			--end;
+
+		Line& line = _lines.emplace_back();
+		line.offset = offset;
+		line.length = end - offset;
+		line.lineBreakLength = next - end;
+		classify(line, source.sliced(line.offset, line.length));
+
+		if (!lineBreakFound && line.lineBreakLength > 0)
+		{
+			_defaultLineBreak = source.sliced(end, line.lineBreakLength).toString();
+			lineBreakFound = true;
+		}
+
+		offset = next;
+	}
+}
+
+QStringView ConfigDocument::text(size_t line) const
+{
+	const Line& l = _lines[line];
+	if (l.replacement)
+		return *l.replacement;
+
+	return QStringView(_source).sliced(l.offset, l.length);
+}
+
+QStringView ConfigDocument::argument(size_t line) const
+{
+	const QStringView lineText = text(line);
+	const qsizetype colon = lineText.indexOf(u':');
+	return colon < 0 ? QStringView{} : lineText.sliced(colon + 1).trimmed();
+}
+
+void ConfigDocument::setDisabled(size_t line, bool disabled)
+{
+	if (_lines[line].disabled == disabled || _lines[line].type == LineType::Blank || _lines[line].type == LineType::Comment)
+		return;
+
+	QString lineText = text(line).toString();
+	const qsizetype start = contentStart(lineText);
+	if (disabled)
+	{
+		lineText.insert(start, u'#');
+	}
+	else
+	{
+		qsizetype end = start + 1; // Past the '#'
+		while (end < lineText.size() && lineText[end].isSpace())
+			++end;
+		lineText.remove(start, end - start);
+	}
+
+	replaceLine(line, std::move(lineText));
+}
+
+void ConfigDocument::replaceLine(size_t line, QString text)
+{
+	Line& l = _lines[line];
+	classify(l, text);
+	l.replacement = std::move(text);
+	_modified = true;
+}
+
+void ConfigDocument::insertLine(size_t before, QString text)
+{
+	// The byte order mark has to stay at the start of the file
+	if (before == 0 && !_lines.empty() && this->text(0).startsWith(QChar::ByteOrderMark))
+	{
+		text.prepend(QChar::ByteOrderMark);
+		replaceLine(0, this->text(0).sliced(1).toString());
+	}
+
+	if (before == _lines.size() && !endsWithLineBreak())
+	{
+		// Turned into an inserted line, which is written with the default line break
+		Line& last = _lines.back();
+		last.replacement = this->text(_lines.size() - 1).toString();
+		last.offset = -1;
+	}
+
+	Line line;
+	classify(line, text);
+	line.replacement = std::move(text);
+	_lines.insert(_lines.begin() + static_cast<std::ptrdiff_t>(before), std::move(line));
+	_modified = true;
+}
+
+QString ConfigDocument::toText() const
+{
+	if (!_modified)
+		return _source;
+
+	QString result;
+	result.reserve(_source.size() + 64);
+	for (size_t i = 0; i < _lines.size(); ++i)
+	{
+		result += text(i);
+		result += lineBreak(_lines[i]);
+	}
+
+	return result;
+}
+
+void ConfigDocument::classify(Line& line, QStringView text)
+{
+	QStringView content = text.sliced(contentStart(text)).trimmed();
+	line.disabled = false;
+
+	if (content.isEmpty())
+	{
+		line.type = LineType::Blank;
+		return;
+	}
+
+	const bool commented = content.startsWith(u'#');
+	if (commented)
+		content = content.sliced(1).trimmed();
+
+	const qsizetype colon = content.indexOf(u':');
+	if (colon <= 0)
+	{
+		line.type = commented ? LineType::Comment : LineType::Other;
+		return;
+	}
+
+	const QStringView name = content.first(colon).trimmed();
+	const QStringView unnumbered = withoutFilterNumber(name);
+	line.type = commented ? LineType::Comment : LineType::Other;
+	for (const Directive& directive : directives)
+	{
+		if ((directive.type == LineType::Filter ? unnumbered : name).compare(directive.name, Qt::CaseInsensitive) == 0)
+		{
+			line.type = directive.type;
+			line.disabled = commented;
+			return;
+		}
+	}
+}
+
+QStringView ConfigDocument::lineBreak(const Line& line) const
+{
+	if (line.offset < 0)
+		return _defaultLineBreak;
+
+	return QStringView(_source).sliced(line.offset + line.length, line.lineBreakLength);
+}
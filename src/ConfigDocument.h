@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+
+#include <optional>
+#include <vector>
+
+// config.txt as a list of typed lines that point into the original text. Edits replace single lines,
+// everything else (unknown directives, comments, formatting, line breaks) is written back byte-for-byte.
+class ConfigDocument final {
+public:
+	enum class LineType {
+		Blank,
+		Comment,
+		Preamp,
+		Include,
+		Device,
+		Channel,
+		Stage,
+		If,
+		ElseIf,
+		Else,
+		EndIf,
+		Filter,
+		Other // Any other directive
+	};
+
+	ConfigDocument() = default;
+	explicit ConfigDocument(QString text);
+
+	[[nodiscard]] size_t size() const { return _lines.size(); }
+	[[nodiscard]] LineType type(size_t line) const { return _lines[line].type; }
+	// A directive commented out with '#'
+	[[nodiscard]] bool isDisabled(size_t line) const { return _lines[line].disabled; }
+	// Without the line break
+	[[nodiscard]] QStringView text(size_t line) const;
+	// The trimmed text after the ':' of a directive
+	[[nodiscard]] QStringView argument(size_t line) const;
+
+	// Comments out or uncomments a directive, leaving the rest of the line as it is
+	void setDisabled(size_t line, bool disabled);
+	void replaceLine(size_t line, QString text);
+	// Shifts the following lines by one. A line appended after a last line without a line break gives it one.
+	void insertLine(size_t before, QString text);
+
+	[[nodiscard]] bool endsWithLineBreak() const { return _lines.empty() || _lines.back().offset < 0 || _lines.back().lineBreakLength > 0; }
+	[[nodiscard]] bool isModified() const { return _modified; }
+	[[nodiscard]] QString toText() const;
+
+private:
+	struct Line {
+		LineType type = LineType::Blank;
+		bool disabled = false;
+		qsizetype offset = -1; // Into _source, -1 for inserted lines
+		qsizetype length = 0; // Without the line break
+		qsizetype lineBreakLength = 0;
+		std::optional<QString> replacement;
+	};
+
+	static void classify(Line& line, QStringView text);
+	[[nodiscard]] QStringView lineBreak(const Line& line) const;
+
+	QString _source;
+	std::vector<Line> _lines;
+	QString _defaultLineBreak = QStringLiteral("\r\n"); // For the inserted lines, the first one in the source if any
+	bool _modified = false;
+};
@@ -0,0 +1,112 @@
+#include "ConfigFileService.h"
+
+#include <QFile>
+#include <QPromise>
+#include <QSaveFile>
+#include <QThread>
+
+#include <memory>
+
+namespace {
+
+// 5, 10, 20, ... 640 ms: about 1.3 s in total before giving up
+inline constexpr int MaxAttempts = 8;
+inline constexpr unsigned long FirstRetryDelayMs = 5;
+
+// Calls attempt() until it succeeds or MaxAttempts is reached, doubling the delay between the attempts
+template <typename Attempt>
+bool retryWithBackoff(Attempt&& attempt)
+{
+	unsigned long delayMs = FirstRetryDelayMs;
+	for (int i = 1;; ++i)
+	{
+		if (attempt())
+			return true;
+
+		if (i == MaxAttempts)
+			return false;
+
+		QThread::msleep(delayMs);
+		delayMs *= 2;
+	}
+}
+
+} // namespace
+
+ConfigFileService::ConfigFileService()
+{
+	_pool.setMaxThreadCount(1);
+}
+
+ConfigFileService::~ConfigFileService()
+{
+	waitForDone();
+}
+
+template <typename T>
+QFuture<T> ConfigFileService::enqueue(std::function<T()> operation)
+{
+	// QThreadPool needs a copyable task, QPromise is move-only
+	auto promise = std::make_shared<QPromise<T>>();
+	QFuture<T> future = promise->future();
+	promise->start();
+
+	_pool.start([promise, operation{ std::move(operation) }] {
+		promise->addResult(operation());
+		promise->finish();
+	});
+
+	return future;
+}
+
+QFuture<std::expected<QByteArray, QString>> ConfigFileService::readFile(const QString& filePath)
+{
+	return enqueue<std::expected<QByteArray, QString>>([filePath]() -> std::expected<QByteArray, QString> {
+		QFile file(filePath);
+		if (!retryWithBackoff([&file] { return file.open(QIODevice::ReadOnly); }))
+			return std::unexpected("Failed to open file for reading: " + filePath);
+
+		QByteArray contents = file.readAll();
+		if (file.error() != QFile::NoError)
+			return std::unexpected("Error while reading " + filePath + ": " + file.errorString());
+
+		return contents;
+	});
+}
+
+QFuture<std::expected<void, QString>> ConfigFileService::replaceFile(const QString& filePath, const QByteArray& contents)
+{
+	return enqueue<std::expected<void, QString>>([filePath, contents]() -> std::expected<void, QString> {
+		QString error;
+		const bool written = retryWithBackoff([&] {
+			// Written to a temporary file that replaces the target, so that readers never see a partial file
+			QSaveFile file(filePath);
+			if (file.open(QIODevice::WriteOnly) && file.write(contents) == contents.size() && file.commit())
+				return true;
+
+			error = file.errorString();
+			return false;
+		});
+
+		if (!written)
+			return std::unexpected("Error writing to " + filePath + ": " + error);
+
+		return {};
+	});
+}
+
+QFuture<std::expected<void, QString>> ConfigFileService::createProfile(const QString& profilePath)
+{
+	return enqueue<std::expected<void, QString>>([profilePath]() -> std::expected<void, QString> {
+		QFile profile(profilePath);
+		if (!profile.exists() && !profile.open(QIODevice::WriteOnly))
+			return std::unexpected("Failed to create file: " + profile.errorString());
+
+		return {};
+	});
+}
+
+void ConfigFileService::waitForDone()
+{
+	_pool.waitForDone();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+#include <QThreadPool>
+
+#include <expected>
+#include <functional>
+
+// Performs all the config file I/O on a worker thread, so that the GUI never waits for Equalizer APO to release a file.
+// The operations are executed one at a time in the order they have been submitted, so a read always sees the writes
+// submitted before it. Locked files are retried with exponential backoff.
+class ConfigFileService final {
+public:
+	ConfigFileService();
+	// Waits for the submitted operations to finish
+	~ConfigFileService();
+
+	ConfigFileService(const ConfigFileService&) = delete;
+	ConfigFileService& operator=(const ConfigFileService&) = delete;
+
+	[[nodiscard]] QFuture<std::expected<QByteArray, QString>> readFile(const QString& filePath);
+	// Atomically replaces the file with the contents
+	QFuture<std::expected<void, QString>> replaceFile(const QString& filePath, const QByteArray& contents);
+	// Creates the profile file if it doesn't exist yet
+	QFuture<std::expected<void, QString>> createProfile(const QString& profilePath);
+
+	void waitForDone();
+
+private:
+	template <typename T>
+	QFuture<T> enqueue(std::function<T()> operation);
+
+	QThreadPool _pool;
+};
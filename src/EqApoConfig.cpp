@@ -1,71 +1,87 @@
 #include "EqApoConfig.h"
 
-#include <QFile>
-#include <QTextStream>
-#include <QThread>
+#include <QLocale>
 
 #include <algorithm>
+#include <utility>
 
-static bool tryOpenFile(QFile& file, QIODevice::OpenMode mode)
+static ConfigDiff diffConfigs(const std::vector<EqProfile>& before, const PreampState& preampBefore, const std::vector<EqProfile>& after, const PreampState& preampAfter)
 {
-	for (int attempt = 0; attempt < 5; ++attempt)
+	ConfigDiff diff;
+	diff.preampChanged = preampBefore != preampAfter;
+
+	// Everything between the common prefix and the common suffix is considered replaced,
+	// which is exact for the usual edits: adding, removing or renaming a single include
+	const size_t commonLength = std::min(before.size(), after.size());
+	size_t prefix = 0;
+	while (prefix < commonLength && before[prefix].name == after[prefix].name)
+		++prefix;
+
+	size_t suffix = 0;
+	while (suffix < commonLength - prefix && before[before.size() - 1 - suffix].name == after[after.size() - 1 - suffix].name)
+		++suffix;
+
+	diff.first = prefix;
+	diff.removedCount = before.size() - prefix - suffix;
+	diff.addedCount = after.size() - prefix - suffix;
+
+	for (size_t i = 0; i < prefix; ++i)
+	{
+		if (before[i].enabled != after[i].enabled)
+			diff.toggled.push_back(i);
+	}
+	for (size_t i = after.size() - suffix, j = before.size() - suffix; i < after.size(); ++i, ++j)
 	{
-		if (file.open(mode))
-			return true;
-		QThread::msleep(20);
+		if (before[j].enabled != after[i].enabled)
+			diff.toggled.push_back(i);
 	}
-	return false;
+
+	return diff;
 }
 
-std::expected<void, QString> EqApoConfig::reloadConfig() noexcept
+std::expected<ConfigDiff, QString> EqApoConfig::reloadConfig(const QByteArray& contents) noexcept
 {
-	_profiles.clear();
-	_preampState = {};
-
-	QFile configFile(_configFolder + "/config.txt");
-	if (!configFile.open(QIODevice::ReadOnly | QIODevice::Text))
-		return std::unexpected("Failed to open config for reading: " + configFile.fileName());
+	const std::vector<EqProfile> previousProfiles = std::exchange(_profiles, {});
+	const PreampState previousPreamp = std::exchange(_preampState, {});
+	_preampLine.reset();
 
-	QTextStream in(&configFile);
-	in.setEncoding(QStringConverter::Utf8);
+	_document = ConfigDocument(QString::fromUtf8(contents));
+	_savedContents = contents;
 
-	QString line;
-	while (in.readLineInto(&line))
+	for (size_t line = 0; line < _document.size(); ++line)
 	{
-		line = line.trimmed();
-		if (line.isEmpty())
-			continue;
-
-		const bool isCommented = line.startsWith("#");
-		const QString cleanLine = isCommented ? line.mid(1).trimmed() : line;
-		if (cleanLine.startsWith("Preamp:", Qt::CaseInsensitive))
+		const bool enabled = !_document.isDisabled(line);
+		switch (_document.type(line))
 		{
-			_preampState.enabled = !isCommented;
-			const QString gainStr = QString{cleanLine}.remove("Preamp:", Qt::CaseInsensitive).remove("dB", Qt::CaseInsensitive).trimmed();
+		case ConfigDocument::LineType::Preamp:
+		{
+			// "Preamp: <gain> dB", the last one is the one shown in the UI
+			QStringView gainText = _document.argument(line);
+			if (gainText.endsWith(u"dB", Qt::CaseInsensitive))
+				gainText.chop(2);
+
 			bool ok = false;
-			const double gain = gainStr.toDouble(&ok);
+			const double gain = gainText.trimmed().toDouble(&ok);
 			if (ok)
-				_preampState.gain = gain;
-			else
-				return std::unexpected("Failed to parse preamp gain from the line\n" + cleanLine);
+			{
+				_preampState = { gain, enabled };
+				_preampLine = line;
+			}
+			else if (enabled)
+			{
+				return std::unexpected("Failed to parse preamp gain from the line\n" + _document.text(line).toString());
+			}
+			break;
 		}
-		else if (cleanLine.startsWith("Include:", Qt::CaseInsensitive))
-		{
-			const QString configFileName = cleanLine.mid(cleanLine.indexOf(':') + 1).trimmed();
-			_profiles.emplace_back(configFileName, !isCommented);
+		case ConfigDocument::LineType::Include:
+			_profiles.emplace_back(_document.argument(line).toString(), enabled, line);
+			break;
+		default:
+			break; // Kept as they are
 		}
-		else
-			return std::unexpected("Unknown line in the config: " + line);
 	}
 
-	if (in.status() != QTextStream::Ok && in.status() != QTextStream::ReadPastEnd)
-		return std::unexpected("Error while reading config: " + configFile.errorString());
-
-	configFile.close();
-	if (configFile.error() != QFile::NoError)
-		return std::unexpected("Error closing config after reading: " + configFile.errorString());
-
-	return {}; // Success
+	return diffConfigs(previousProfiles, previousPreamp, _profiles, _preampState);
 }
 
 QString EqApoConfig::configFolder() const
@@ -73,6 +89,11 @@ QString EqApoConfig::configFolder() const
 	return _configFolder;
 }
 
+QString EqApoConfig::configFilePath() const
+{
+	return _configFolder + "/config.txt";
+}
+
 const std::vector<EqProfile>& EqApoConfig::profiles() const
 {
 	return _profiles;
@@ -83,78 +104,84 @@ PreampState EqApoConfig::preamp() const
 	return _preampState;
 }
 
-std::expected<QString, QString> EqApoConfig::createNewProfile(const QString& name) noexcept
+QString EqApoConfig::profileFileName(const QString& name)
 {
 	QString fileName = name;
 	if (!fileName.endsWith(".txt", Qt::CaseInsensitive))
 		fileName += ".txt";
 
-	QString filePath = configFolder() + "/" + fileName;
-
-	{
-		QFile file(filePath);
-		if (!file.exists())
-		{
-			if (!file.open(QIODevice::WriteOnly))
-				return std::unexpected("Failed to create file: " + file.errorString());
-		}
-	}
-
-	// Append the new config to config.txt as a commented Include so it appears in the UI
-	{
-		QFile cfg(configFolder() + "/config.txt");
-		if (!tryOpenFile(cfg, QIODevice::Append | QIODevice::Text))
-			return std::unexpected("Failed to open config.txt for appending: " + cfg.errorString());
-
-		const QString includeLine = QString("#Include: %1\r\n").arg(fileName);
-
-		const bool includeExists = std::find_if(_profiles.begin(), _profiles.end(), [&](const EqProfile& item) -> bool { return item.name.compare(name, Qt::CaseInsensitive) == 0; }) != _profiles.end();
-		if (includeExists)
-			return filePath; // Success and do nothing
-
-		cfg.write(includeLine.toUtf8());
-		if (cfg.error() != QFile::NoError)
-			return std::unexpected("Failed to write to config.txt: " + cfg.errorString());
-	}
+	return fileName;
+}
 
-	return filePath; // success
+bool EqApoConfig::addProfileInclude(const QString& fileName)
+{
+	const bool includeExists = std::any_of(_profiles.begin(), _profiles.end(), [&](const EqProfile& item) {
+		return item.name.compare(fileName, Qt::CaseInsensitive) == 0;
+	});
+	if (includeExists)
+		return false;
+
+	// Commented out so that it appears in the UI without being enabled
+	_document.insertLine(_document.size(), "#Include: " + fileName);
+	return true;
 }
 
 void EqApoConfig::setProfileEnabled(size_t index, bool enabled)
 {
-	_profiles[index].enabled = enabled;
+	EqProfile& profile = _profiles[index];
+	if (profile.enabled == enabled)
+		return;
+
+	profile.enabled = enabled;
+	_document.setDisabled(profile.line, !enabled);
 }
 
 void EqApoConfig::setPreampGain(double gain, bool enabled)
 {
-	_preampState.gain = gain;
-	_preampState.enabled = enabled;
-}
+	const PreampState state{ gain, enabled };
+	if (state == _preampState)
+		return;
 
-std::expected<void, QString> EqApoConfig::saveState() noexcept
-{
-	QFile configFile(_configFolder + "/config.txt");
-	if (!tryOpenFile(configFile, QFile::WriteOnly))
-		return std::unexpected("Failed to open config for writing: " + configFile.errorString());
+	_preampState = state;
 
-	QString preampLine = QString("Preamp: %1 dB\r\n").arg(_preampState.gain, 0, 'f', 1);
-	if (!_preampState.enabled)
-		preampLine.prepend("#"); // Comment out if disabled
-	configFile.write(preampLine.toLatin1());
+	QString line = QString("Preamp: %1 dB").arg(QString::number(gain, 'f', QLocale::FloatingPointShortest));
+	if (!enabled)
+		line.prepend('#');
 
-	// Profiles
-	for (const EqProfile& profile: std::as_const(_profiles))
+	if (_preampLine)
 	{
-		QString line = "Include: " + profile.name + "\r\n";
-		if (!profile.enabled)
-			line.prepend('#');
-
-		configFile.write(line.toUtf8());
+		_document.replaceLine(*_preampLine, std::move(line));
+		return;
 	}
 
-	configFile.close();
-	if (configFile.error() != QFile::NoError)
-		return std::unexpected("Error writing to the config file: " + configFile.errorString());
+	// At the top, so that it applies to all the channels and devices
+	_document.insertLine(0, std::move(line));
+	_preampLine = 0;
+	for (EqProfile& profile : _profiles)
+		++profile.line;
+}
+
+QByteArray EqApoConfig::serializeState() const
+{
+	return _document.toText().toUtf8();
+}
 
-	return {};
+std::optional<QByteArray> EqApoConfig::takeStateToSave()
+{
+	// Every write makes Equalizer APO rebuild its filters, so identical contents are not written again.
+	// An unmodified document is never written back, not even re-encoded.
+	if (!_document.isModified())
+		return std::nullopt;
+
+	QByteArray contents = serializeState();
+	if (contents == _savedContents)
+		return std::nullopt;
+
+	_savedContents = contents;
+	return contents;
+}
+
+void EqApoConfig::onSaveFailed()
+{
+	_savedContents.clear();
 }
@@ -1,38 +1,76 @@
 #pragma once
 
+#include "ConfigDocument.h"
+
+#include <QByteArray>
 #include <QString>
 
 #include <expected>
+#include <optional>
 #include <vector>
 
 struct EqProfile {
 	QString name;
 	bool enabled;
+	size_t line = 0; // Of the Include in the config document
 };
 
 struct PreampState {
 	double gain = 0.0;
 	bool enabled = false;
+
+	bool operator==(const PreampState&) const = default;
 };
 
+// What a reload has changed compared to the previous state.
+// The profiles [first, first + removedCount) of the previous list have been replaced by [first, first + addedCount)
+// of the new one, the profiles before and after that range are the same files in the same order.
+struct ConfigDiff {
+	size_t first = 0;
+	size_t removedCount = 0;
+	size_t addedCount = 0;
+	std::vector<size_t> toggled; // Indices into the new list of the kept profiles that have been enabled or disabled
+	bool preampChanged = false;
+
+	[[nodiscard]] bool isEmpty() const { return removedCount == 0 && addedCount == 0 && toggled.empty() && !preampChanged; }
+};
+
+// The state of config.txt. Doesn't do any I/O, see ConfigFileService.
 class EqApoConfig
 {
 public:
-	[[nodiscard]] std::expected<void, QString> reloadConfig() noexcept;
+	// Replaces the state with the parsed config.txt contents. Only the Preamp and Include lines are interpreted,
+	// the other ones are kept as they are. On failure the state holds whatever has been parsed up to the error.
+	[[nodiscard]] std::expected<ConfigDiff, QString> reloadConfig(const QByteArray& contents) noexcept;
 
 	[[nodiscard]] QString configFolder() const;
+	[[nodiscard]] QString configFilePath() const;
 	[[nodiscard]] const std::vector<EqProfile>& profiles() const;
 	[[nodiscard]] PreampState preamp() const;
 
+	// The profile file name for a name with or without the .txt extension
+	[[nodiscard]] static QString profileFileName(const QString& name);
+	// Appends a commented out Include line for a new profile, returns false if it is already included.
+	// The profile list is left as it is, the profile appears in it when the saved config is read back.
+	bool addProfileInclude(const QString& fileName);
 
-	[[nodiscard]] std::expected<QString /* filepath */, QString> createNewProfile(const QString& name) noexcept;
 	void setProfileEnabled(size_t index, bool enabled);
 	void setPreampGain(double gain, bool enabled);
-	[[nodiscard]] std::expected<void, QString> saveState() noexcept;
+
+	// The config.txt contents with the changes applied to the lines they concern
+	[[nodiscard]] QByteArray serializeState() const;
+	// Returns the contents to write if the state differs from the last one read or saved, and considers them saved
+	[[nodiscard]] std::optional<QByteArray> takeStateToSave();
+	// The next takeStateToSave() returns the state even if it hasn't changed
+	void onSaveFailed();
 
 private:
 	const QString _configFolder = "C:/Program Files/EqualizerAPO/config";
 
+	ConfigDocument _document;
 	std::vector<EqProfile> _profiles;
 	PreampState _preampState;
+	std::optional<size_t> _preampLine;
+
+	QByteArray _savedContents; // The contents as of the last reload or save
 };
@@ -0,0 +1,86 @@
+#include "FileChangeWatcher.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+namespace {
+
+QByteArray hashContents(const QByteArray& contents)
+{
+	return QCryptographicHash::hash(contents, QCryptographicHash::Md5);
+}
+
+} // namespace
+
+FileChangeWatcher::FileChangeWatcher(std::function<void(const QStringList& changedFiles)> onChanged) :
+	_onChanged(std::move(onChanged))
+{
+	_debounceTimer.setSingleShot(true);
+	_debounceTimer.setInterval(DebounceIntervalMs);
+	QObject::connect(&_debounceTimer, &QTimer::timeout, [this] { reportChanges(); });
+	QObject::connect(&_watcher, &QFileSystemWatcher::fileChanged, [this](const QString& filePath) { onFileChanged(filePath); });
+}
+
+void FileChangeWatcher::setFiles(const QStringList& filePaths)
+{
+	const QSet<QString> files(filePaths.begin(), filePaths.end());
+
+	QStringList removed;
+	for (const QString& file : std::as_const(_watchedFiles))
+	{
+		if (!files.contains(file))
+		{
+			removed.push_back(file);
+			_knownHashes.remove(file);
+			_pendingFiles.remove(file);
+		}
+	}
+
+	QStringList added;
+	for (const QString& file : files)
+	{
+		if (!_watchedFiles.contains(file))
+			added.push_back(file);
+	}
+
+	if (!removed.isEmpty())
+		_watcher.removePaths(removed);
+	if (!added.isEmpty())
+		_watcher.addPaths(added); // Files that don't exist (yet) are silently not watched
+
+	_watchedFiles = files;
+}
+
+void FileChangeWatcher::noteOwnWrite(const QString& filePath, const QByteArray& contents)
+{
+	_knownHashes.insert(filePath, hashContents(contents));
+}
+
+void FileChangeWatcher::onFileChanged(const QString& filePath)
+{
+	_pendingFiles.insert(filePath);
+	_debounceTimer.start(); // Restarts the interval on every write of the burst
+}
+
+void FileChangeWatcher::reportChanges()
+{
+	QStringList changedFiles;
+	for (const QString& filePath : std::as_const(_pendingFiles))
+	{
+		// Files replaced by a rename (atomic saves) drop out of the watcher and have to be added again
+		if (!_watcher.files().contains(filePath))
+			_watcher.addPath(filePath);
+
+		QFile file(filePath);
+		const QByteArray hash = file.open(QIODevice::ReadOnly) ? hashContents(file.readAll()) : QByteArray{};
+		if (const auto it = _knownHashes.constFind(filePath); it != _knownHashes.cend() && it.value() == hash)
+			continue;
+
+		_knownHashes.insert(filePath, hash);
+		changedFiles.push_back(filePath);
+	}
+	_pendingFiles.clear();
+
+	if (!changedFiles.isEmpty())
+		_onChanged(changedFiles);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include <functional>
+
+// Reports the files that other programs have changed. A burst of writes is reported once, after the files have been
+// quiet for DebounceIntervalMs. Changes that leave the contents as they were last seen are not reported, which includes
+// our own writes as long as they are announced with noteOwnWrite().
+class FileChangeWatcher final {
+public:
+	static constexpr int DebounceIntervalMs = 200;
+
+	explicit FileChangeWatcher(std::function<void(const QStringList& changedFiles)> onChanged);
+
+	// Replaces the set of watched files
+	void setFiles(const QStringList& filePaths);
+	// Must be called before writing, so that the resulting notification is recognized
+	void noteOwnWrite(const QString& filePath, const QByteArray& contents);
+
+private:
+	void onFileChanged(const QString& filePath);
+	void reportChanges();
+
+	const std::function<void(const QStringList& changedFiles)> _onChanged;
+
+	QFileSystemWatcher _watcher;
+	QTimer _debounceTimer;
+
+	QSet<QString> _watchedFiles;
+	QSet<QString> _pendingFiles;
+	QHash<QString, QByteArray> _knownHashes; // The last contents seen or written by us
+};
@@ -1,8 +1,16 @@
 #include "Filter.h"
 
+#include <QLocale>
+
+// The shortest representation that reads back as exactly the same value, so that saving doesn't round anything
+static QString formatValue(double value)
+{
+	return QString::number(value, 'f', QLocale::FloatingPointShortest);
+}
+
 QString PreampFilter::toConfigLine() const
 {
-	return QString("Preamp: %1 dB").arg(_gain, 0, 'f', 1);
+	return QString("Preamp: %1 dB").arg(formatValue(_gain));
 }
 
 QString PreampFilter::displayName() const
@@ -10,21 +18,63 @@ QString PreampFilter::displayName() const
 	return QString("Preamp: %1 dB").arg(_gain, 0, 'f', 1);
 }
 
-QString PeakingFilter::toConfigLine() const
+template<BiquadType T>
+QString BiquadFilter<T>::toConfigLine() const
 {
-	return QString("Filter: ON PK Fc %1 Hz Gain %2 dB Q %3")
-		.arg(_fc, 0, 'f', 1)
-		.arg(_gain, 0, 'f', 1)
-		.arg(_q, 0, 'f', 2);
+	// The Q is left out when it's optional and has its default value, so that "LP Fc 100 Hz" doesn't become "LPQ"
+	const bool withQ = Traits.q == QUsage::Required || (Traits.q == QUsage::Optional && _q != Traits.defaultQ);
+	const QStringView token = withQ && !Traits.qToken.isEmpty() ? Traits.qToken : Traits.token;
+
+	QString line = QString("Filter: ON %1 Fc %2 Hz").arg(token.toString(), formatValue(_fc));
+	if constexpr (Traits.hasGain)
+		line += QString(" Gain %1 dB").arg(formatValue(_gain));
+	if (withQ)
+		line += QString(" Q %1").arg(formatValue(_q));
+
+	return line;
 }
 
-QString PeakingFilter::displayName() const
+template<BiquadType T>
+QString BiquadFilter<T>::displayName() const
 {
-	return QString("PK: %1 Hz, %2 dB, Q=%3")
-		.arg(_fc, 0, 'f', 1)
-		.arg(_gain > 0 ? "+" : "")
-		.arg(_gain, 0, 'f', 1)
-		.arg(_q, 0, 'f', 2);
+	QString name = QString("%1: %2 Hz").arg(Traits.token.toString()).arg(_fc, 0, 'f', 1);
+	if constexpr (Traits.hasGain)
+		name += QString(", %1%2 dB").arg(_gain > 0 ? "+" : "").arg(_gain, 0, 'f', 1);
+	if constexpr (Traits.q != QUsage::None)
+		name += QString(", Q=%1").arg(_q, 0, 'f', 2);
+
+	return name;
+}
+
+template class BiquadFilter<BiquadType::Peaking>;
+template class BiquadFilter<BiquadType::LowShelf>;
+template class BiquadFilter<BiquadType::HighShelf>;
+template class BiquadFilter<BiquadType::LowShelfCenter>;
+template class BiquadFilter<BiquadType::HighShelfCenter>;
+template class BiquadFilter<BiquadType::LowPass>;
+template class BiquadFilter<BiquadType::HighPass>;
+template class BiquadFilter<BiquadType::BandPass>;
+template class BiquadFilter<BiquadType::Notch>;
+template class BiquadFilter<BiquadType::AllPass>;
+
+Filter makeBiquadFilter(BiquadType type, double fc, double gain, double q, bool enabled)
+{
+	switch (type)
+	{
+	case BiquadType::Peaking: return PeakingFilter{ fc, gain, q, enabled };
+	case BiquadType::LowShelf: return LowShelfFilter{ fc, gain, q, enabled };
+	case BiquadType::HighShelf: return HighShelfFilter{ fc, gain, q, enabled };
+	case BiquadType::LowShelfCenter: return LowShelfCenterFilter{ fc, gain, q, enabled };
+	case BiquadType::HighShelfCenter: return HighShelfCenterFilter{ fc, gain, q, enabled };
+	case BiquadType::LowPass: return LowPassFilter{ fc, gain, q, enabled };
+	case BiquadType::HighPass: return HighPassFilter{ fc, gain, q, enabled };
+	case BiquadType::BandPass: return BandPassFilter{ fc, gain, q, enabled };
+	case BiquadType::Notch: return NotchFilter{ fc, gain, q, enabled };
+	case BiquadType::AllPass: return AllPassFilter{ fc, gain, q, enabled };
+	default: break;
+	}
+
+	return UnsupportedFilter{ QString(), enabled };
 }
 
 QString UnsupportedFilter::toConfigLine() const
@@ -1,7 +1,13 @@
 #pragma once
 
 #include <QString>
-#include <memory>
+#include <QStringView>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <variant>
+#include <vector>
 
 // Base filter interface
 class IFilter {
@@ -27,16 +33,74 @@ public:
 	double gain() const { return _gain; }
 	void setGain(double gain) { _gain = gain; }
 
+	bool operator==(const PreampFilter& other) const { return _gain == other._gain && _enabled == other._enabled; }
+
 private:
 	double _gain = 0.0;
 	bool _enabled = true;
 };
 
-// Peaking filter (PK)
-class PeakingFilter final : public IFilter {
+// The biquad types of Equalizer APO, the coefficients follow the RBJ Audio EQ Cookbook
+enum class BiquadType : uint8_t {
+	Peaking, // PK
+	LowShelf, // LS
+	HighShelf, // HS
+	LowShelfCenter, // LSC
+	HighShelfCenter, // HSC
+	LowPass, // LP, LPQ
+	HighPass, // HP, HPQ
+	BandPass, // BP
+	Notch, // NO
+	AllPass, // AP
+	Count
+};
+
+enum class QUsage {
+	None,
+	Optional, // defaultQ when omitted
+	Required
+};
+
+struct BiquadTraits {
+	QStringView token; // The E-APO type token
+	QStringView qToken; // The token of the variant that takes a Q, empty if the Q goes with the plain token
+	const char* name;
+	bool hasGain;
+	QUsage q;
+	double defaultQ; // For LS and HS, which don't take a Q, the fixed shelf slope S
+};
+
+inline constexpr double ButterworthQ = 0.70710678118654752440;
+
+constexpr BiquadTraits biquadTraits(BiquadType type)
+{
+	switch (type)
+	{
+	case BiquadType::Peaking: return { u"PK", {}, "Peak", true, QUsage::Required, 1.0 };
+	case BiquadType::LowShelf: return { u"LS", {}, "Low Shelf", true, QUsage::None, 0.9 };
+	case BiquadType::HighShelf: return { u"HS", {}, "High Shelf", true, QUsage::None, 0.9 };
+	case BiquadType::LowShelfCenter: return { u"LSC", {}, "Low Shelf", true, QUsage::Optional, ButterworthQ };
+	case BiquadType::HighShelfCenter: return { u"HSC", {}, "High Shelf", true, QUsage::Optional, ButterworthQ };
+	case BiquadType::LowPass: return { u"LP", u"LPQ", "Low Pass", false, QUsage::Optional, ButterworthQ };
+	case BiquadType::HighPass: return { u"HP", u"HPQ", "High Pass", false, QUsage::Optional, ButterworthQ };
+	case BiquadType::BandPass: return { u"BP", {}, "Band Pass", false, QUsage::Optional, ButterworthQ };
+	case BiquadType::Notch: return { u"NO", {}, "Notch", false, QUsage::Optional, ButterworthQ };
+	case BiquadType::AllPass: return { u"AP", {}, "All Pass", false, QUsage::Optional, ButterworthQ };
+	default: return {};
+	}
+}
+
+// One class per biquad type, so that the coefficients are computed by a function specialized for the type
+// (see calculateBiquadCoefficients) and nothing is dispatched at run time once the filter bank is built.
+// The gain of the types without one is always 0.
+template<BiquadType T>
+class BiquadFilter final : public IFilter {
 public:
-	PeakingFilter(double fc, double gain, double q, bool enabled = true)
-		: _fc(fc), _gain(gain), _q(q), _enabled(enabled) {}
+	static constexpr BiquadType Type = T;
+	static constexpr BiquadTraits Traits = biquadTraits(T);
+
+	BiquadFilter(double fc, double gain, double q, bool enabled = true)
+		: _fc(fc), _gain(Traits.hasGain ? gain : 0.0), _q(q), _enabled(enabled) {}
 
 	QString toConfigLine() const override;
 	QString displayName() const override;
@@ -48,9 +112,14 @@ public:
 	double q() const { return _q; }
 
 	void setFc(double fc) { _fc = fc; }
-	void setGain(double gain) { _gain = gain; }
+	void setGain(double gain) { _gain = Traits.hasGain ? gain : 0.0; }
 	void setQ(double q) { _q = q; }
 
+	bool operator==(const BiquadFilter& other) const
+	{
+		return _fc == other._fc && _gain == other._gain && _q == other._q && _enabled == other._enabled;
+	}
+
 private:
 	double _fc = 1000.0;  // Center frequency in Hz
 	double _gain = 0.0;   // Gain in dB
@@ -58,6 +127,33 @@ private:
 	bool _enabled = true;
 };
 
+extern template class BiquadFilter<BiquadType::Peaking>;
+extern template class BiquadFilter<BiquadType::LowShelf>;
+extern template class BiquadFilter<BiquadType::HighShelf>;
+extern template class BiquadFilter<BiquadType::LowShelfCenter>;
+extern template class BiquadFilter<BiquadType::HighShelfCenter>;
+extern template class BiquadFilter<BiquadType::LowPass>;
+extern template class BiquadFilter<BiquadType::HighPass>;
+extern template class BiquadFilter<BiquadType::BandPass>;
+extern template class BiquadFilter<BiquadType::Notch>;
+extern template class BiquadFilter<BiquadType::AllPass>;
+
+using PeakingFilter = BiquadFilter<BiquadType::Peaking>;
+using LowShelfFilter = BiquadFilter<BiquadType::LowShelf>;
+using HighShelfFilter = BiquadFilter<BiquadType::HighShelf>;
+using LowShelfCenterFilter = BiquadFilter<BiquadType::LowShelfCenter>;
+using HighShelfCenterFilter = BiquadFilter<BiquadType::HighShelfCenter>;
+using LowPassFilter = BiquadFilter<BiquadType::LowPass>;
+using HighPassFilter = BiquadFilter<BiquadType::HighPass>;
+using BandPassFilter = BiquadFilter<BiquadType::BandPass>;
+using NotchFilter = BiquadFilter<BiquadType::Notch>;
+using AllPassFilter = BiquadFilter<BiquadType::AllPass>;
+
+template<typename FilterType>
+inline constexpr bool isBiquadFilter = false;
+template<BiquadType T>
+inline constexpr bool isBiquadFilter<BiquadFilter<T>> = true;
+
 // Unsupported filter (preserved as-is)
 class UnsupportedFilter final : public IFilter {
 public:
@@ -71,9 +167,52 @@ public:
 
 	QString originalLine() const { return _originalLine; }
 
+	bool operator==(const UnsupportedFilter& other) const { return _originalLine == other._originalLine && _enabled == other._enabled; }
+
 private:
 	QString _originalLine;
 	bool _enabled;
 };
 
-using FilterUniquePtr = std::unique_ptr<IFilter>;
+// Filters are stored by value in a contiguous array and dispatched on the type tag of the variant,
+// IFilter is kept for the code that doesn't care about the specific filter type
+using Filter = std::variant<PreampFilter, PeakingFilter, LowShelfFilter, HighShelfFilter, LowShelfCenterFilter, HighShelfCenterFilter,
+	LowPassFilter, HighPassFilter, BandPassFilter, NotchFilter, AllPassFilter, UnsupportedFilter>;
+using FilterList = std::vector<Filter>;
+
+// The filter of the given run-time type, for the code that reads filters back from storage
+Filter makeBiquadFilter(BiquadType type, double fc, double gain, double q, bool enabled);
+
+inline IFilter& asIFilter(Filter& filter)
+{
+	return std::visit([](auto& f) -> IFilter& { return f; }, filter);
+}
+
+inline const IFilter& asIFilter(const Filter& filter)
+{
+	return std::visit([](const auto& f) -> const IFilter& { return f; }, filter);
+}
+
+// One bit per channel, in Equalizer APO's 7.1 order
+using ChannelMask = uint8_t;
+inline constexpr size_t MaxChannels = 8;
+inline constexpr ChannelMask AllChannels = 0xFF;
+inline constexpr std::array<QStringView, MaxChannels> ChannelNames{ u"L", u"R", u"C", u"SUB", u"RL", u"RR", u"SL", u"SR" };
+
+// A filter chain where every filter applies to the channels selected by the last "Channel:" line before it
+struct ChannelFilterList {
+	FilterList filters;
+	std::vector<ChannelMask> channels; // Parallel to filters
+	ChannelMask namedChannels = 0; // Every channel selected by name or number, "all" doesn't count
+
+	// The channels up to the last one named, 0 if the chain isn't channel-scoped
+	[[nodiscard]] size_t channelCount() const { return static_cast<size_t>(std::bit_width(namedChannels)); }
+
+	void append(Filter filter, ChannelMask mask)
+	{
+		filters.push_back(std::move(filter));
+		channels.push_back(mask);
+	}
+
+	bool operator==(const ChannelFilterList& other) const = default;
+};
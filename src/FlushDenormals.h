@@ -0,0 +1,29 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define FLUSH_DENORMALS_X86
+#endif
+
+// Treats denormals as zero on this thread for the lifetime of the object. The state of recursive filters decays
+// into denormals once the input goes silent, and on x86 those are slow enough to blow the budget of an audio block.
+class FlushDenormals final {
+public:
+#ifdef FLUSH_DENORMALS_X86
+	FlushDenormals() : _csr(_mm_getcsr()) { _mm_setcsr(_csr | FlushToZero | DenormalsAreZero); }
+	~FlushDenormals() { _mm_setcsr(_csr); }
+#else
+	FlushDenormals() = default;
+#endif
+
+	FlushDenormals(const FlushDenormals&) = delete;
+	FlushDenormals& operator=(const FlushDenormals&) = delete;
+
+#ifdef FLUSH_DENORMALS_X86
+private:
+	static constexpr unsigned int FlushToZero = 0x8000;
+	static constexpr unsigned int DenormalsAreZero = 0x0040;
+
+	unsigned int _csr;
+#endif
+};
@@ -0,0 +1,708 @@
+#include "FrequencyResponse.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FREQUENCY_RESPONSE_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+void FilterBank::addBiquad(const BiquadCoefficients& coef)
+{
+	b0.push_back(coef.b0);
+	b1.push_back(coef.b1);
+	b2.push_back(coef.b2);
+	a0.push_back(coef.a0);
+	a1.push_back(coef.a1);
+	a2.push_back(coef.a2);
+}
+
+void FilterBank::addFilter(const Filter& filter, double sampleRate)
+{
+	std::visit([this, sampleRate](const auto& f) {
+		using FilterType = std::decay_t<decltype(f)>;
+
+		if (!f.isEnabled())
+			return;
+
+		if constexpr (std::is_same_v<FilterType, PreampFilter>)
+			gainDb += f.gain();
+		else if constexpr (isBiquadFilter<FilterType>)
+			addBiquad(calculateBiquadCoefficients<FilterType::Type>(f.fc(), f.gain(), f.q(), sampleRate));
+		// Unsupported filters are ignored
+	}, filter);
+}
+
+void FilterBank::append(const FilterBank& other)
+{
+	b0.insert(b0.end(), other.b0.begin(), other.b0.end());
+	b1.insert(b1.end(), other.b1.begin(), other.b1.end());
+	b2.insert(b2.end(), other.b2.begin(), other.b2.end());
+	a0.insert(a0.end(), other.a0.begin(), other.a0.end());
+	a1.insert(a1.end(), other.a1.begin(), other.a1.end());
+	a2.insert(a2.end(), other.a2.begin(), other.a2.end());
+	gainDb += other.gainDb;
+}
+
+FilterBank FilterBank::fromFilter(const Filter& filter, double sampleRate)
+{
+	FilterBank bank;
+	bank.addFilter(filter, sampleRate);
+	return bank;
+}
+
+FilterBank FilterBank::fromFilters(const FilterList& filters, double sampleRate)
+{
+	FilterBank bank;
+	for (const Filter& filter : filters)
+		bank.addFilter(filter, sampleRate);
+
+	return bank;
+}
+
+ChannelFilterBank ChannelFilterBank::fromFilters(const ChannelFilterList& filters, double sampleRate)
+{
+	ChannelFilterBank bank;
+	bank.channelCount = filters.channelCount();
+
+	std::array<FilterBank, MaxChannels> chains;
+	size_t sectionCount = 0;
+	for (size_t c = 0; c < bank.channelCount; ++c)
+	{
+		for (size_t i = 0; i < filters.filters.size(); ++i)
+		{
+			if (filters.channels[i] & (1u << c))
+				chains[c].addFilter(filters.filters[i], sampleRate);
+		}
+
+		bank.gainDb[c] = chains[c].gainDb;
+		sectionCount = std::max(sectionCount, chains[c].size());
+	}
+
+	// Pass-through sections have a power ratio of exactly 1
+	const size_t size = sectionCount * MaxChannels;
+	bank.b0.assign(size, 1.0);
+	bank.b1.assign(size, 0.0);
+	bank.b2.assign(size, 0.0);
+	bank.a0.assign(size, 1.0);
+	bank.a1.assign(size, 0.0);
+	bank.a2.assign(size, 0.0);
+	for (size_t c = 0; c < bank.channelCount; ++c)
+	{
+		const FilterBank& chain = chains[c];
+		for (size_t k = 0; k < chain.size(); ++k)
+		{
+			const size_t j = k * MaxChannels + c;
+			bank.b0[j] = chain.b0[k];
+			bank.b1[j] = chain.b1[k];
+			bank.b2[j] = chain.b2[k];
+			bank.a0[j] = chain.a0[k];
+			bank.a1[j] = chain.a1[k];
+			bank.a2[j] = chain.a2[k];
+		}
+	}
+
+	return bank;
+}
+
+FrequencyGrid::FrequencyGrid(std::vector<double> frequencies, double sampleRate) :
+	_frequencies(std::move(frequencies)),
+	_sampleRate(sampleRate)
+{
+	const size_t count = _frequencies.size();
+	_cos1.resize(count);
+	_sin1.resize(count);
+	_cos2.resize(count);
+	_sin2.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const double omega = 2.0 * M_PI * _frequencies[i] / sampleRate;
+		_cos1[i] = std::cos(omega);
+		_sin1[i] = std::sin(omega);
+		_cos2[i] = std::cos(2.0 * omega);
+		_sin2[i] = std::sin(2.0 * omega);
+	}
+}
+
+FrequencyGrid FrequencyGrid::logarithmic(size_t numPoints, double minFreq, double maxFreq, double sampleRate)
+{
+	std::vector<double> frequencies(numPoints);
+
+	const double logMin = std::log10(minFreq);
+	const double logMax = std::log10(maxFreq);
+
+	for (size_t i = 0; i < numPoints; ++i)
+	{
+		const double logFreq = numPoints > 1 ? logMin + (logMax - logMin) * i / (numPoints - 1) : logMin;
+		frequencies[i] = std::pow(10.0, logFreq);
+	}
+
+	return FrequencyGrid{ std::move(frequencies), sampleRate };
+}
+
+namespace {
+
+// The product of the power ratios is converted to dB at least every this many filters.
+// At +-20 dB per filter (the editor limit) this keeps the product within +-1280 dB, far from the double range limits.
+inline constexpr size_t MaxFiltersPerProduct = 64;
+
+// |B(e^jw)|^2 / |A(e^jw)|^2 of the k-th biquad at the i-th point
+inline double powerRatio(const FilterBank& bank, size_t k, const FrequencyGrid& grid, size_t i)
+{
+	const double c1 = grid.cos1()[i], s1 = grid.sin1()[i], c2 = grid.cos2()[i], s2 = grid.sin2()[i];
+
+	const double numReal = bank.b0[k] + bank.b1[k] * c1 + bank.b2[k] * c2;
+	const double numImag = bank.b1[k] * s1 + bank.b2[k] * s2;
+	const double denReal = bank.a0[k] + bank.a1[k] * c1 + bank.a2[k] * c2;
+	const double denImag = bank.a1[k] * s1 + bank.a2[k] * s2;
+
+	return (numReal * numReal + numImag * numImag) / (denReal * denReal + denImag * denImag);
+}
+
+void evaluateScalar(const FilterBank& bank, const FrequencyGrid& grid, double* response, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		double db = bank.gainDb;
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			double product = 1.0;
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+				product *= powerRatio(bank, k, grid, i);
+
+			db += 10.0 * std::log10(product); // 10 * log10(|H|^2) == 20 * log10(|H|)
+		}
+
+		response[i] = db;
+	}
+}
+
+// The phase and the group delay come from the same evaluation of the numerator and the denominator as the magnitude.
+// The grid's basis is e^(+jw), so what is evaluated is conj(B) and conj(A): their product conj(B) * A / |A|^2
+// is conj(H), and the phase is negated once per product.
+// The group delay of b0 + b1 z^-1 + b2 z^-2 is Re((b1 e^(-jw) + 2 b2 e^(-j2w)) / B(e^(jw))), which the conjugation
+// of both terms leaves unchanged; the biquad's one is the numerator's minus the denominator's.
+void evaluateFullScalar(const FilterBank& bank, const FrequencyGrid& grid, double* response, double* phase, double* delay, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		const double c1 = grid.cos1()[i], s1 = grid.sin1()[i], c2 = grid.cos2()[i], s2 = grid.sin2()[i];
+
+		double db = bank.gainDb;
+		double radians = 0.0;
+		double samples = 0.0;
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			double product = 1.0;
+			double hReal = 1.0, hImag = 0.0;
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+			{
+				const double numReal = bank.b0[k] + bank.b1[k] * c1 + bank.b2[k] * c2;
+				const double numImag = bank.b1[k] * s1 + bank.b2[k] * s2;
+				const double denReal = bank.a0[k] + bank.a1[k] * c1 + bank.a2[k] * c2;
+				const double denImag = bank.a1[k] * s1 + bank.a2[k] * s2;
+
+				// A notch puts a zero of the numerator on the unit circle, its delay term is left out there instead of
+				// turning the whole point into NaN
+				const double num = numReal * numReal + numImag * numImag;
+				const double den = denReal * denReal + denImag * denImag;
+				const double invNum = num > 0.0 ? 1.0 / num : 0.0;
+				const double invDen = 1.0 / den;
+				product *= num * invDen;
+
+				const double real = (numReal * denReal + numImag * denImag) * invDen;
+				const double imag = (numImag * denReal - numReal * denImag) * invDen;
+				const double nextReal = hReal * real - hImag * imag;
+				hImag = hReal * imag + hImag * real;
+				hReal = nextReal;
+
+				const double numDelay = (bank.b1[k] * c1 + 2.0 * bank.b2[k] * c2) * numReal + (bank.b1[k] * s1 + 2.0 * bank.b2[k] * s2) * numImag;
+				const double denDelay = (bank.a1[k] * c1 + 2.0 * bank.a2[k] * c2) * denReal + (bank.a1[k] * s1 + 2.0 * bank.a2[k] * s2) * denImag;
+				samples += numDelay * invNum - denDelay * invDen;
+			}
+
+			db += 10.0 * std::log10(product);
+			radians -= std::atan2(hImag, hReal);
+		}
+
+		response[i] = db;
+		phase[i] = radians;
+		delay[i] = samples;
+	}
+}
+
+#ifndef FREQUENCY_RESPONSE_X86_SIMD
+
+void evaluateScalar(const FilterBank& bank, const FrequencyGrid& grid, double* response, size_t count)
+{
+	evaluateScalar(bank, grid, response, 0, count);
+}
+
+void evaluateFullScalar(const FilterBank& bank, const FrequencyGrid& grid, double* response, double* phase, double* delay, size_t count)
+{
+	evaluateFullScalar(bank, grid, response, phase, delay, 0, count);
+}
+
+// Channel after channel, the padding of the shorter chains only ever multiplies the products by 1
+void evaluateChannelsScalar(const ChannelFilterBank& bank, const FrequencyGrid& grid, double* response)
+{
+	const size_t count = grid.size();
+	for (size_t c = 0; c < bank.channelCount; ++c)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const double c1 = grid.cos1()[i], s1 = grid.sin1()[i], c2 = grid.cos2()[i], s2 = grid.sin2()[i];
+
+			double db = bank.gainDb[c];
+			for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+			{
+				double product = 1.0;
+				for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+				{
+					const size_t j = k * MaxChannels + c;
+					const double numReal = bank.b0[j] + bank.b1[j] * c1 + bank.b2[j] * c2;
+					const double numImag = bank.b1[j] * s1 + bank.b2[j] * s2;
+					const double denReal = bank.a0[j] + bank.a1[j] * c1 + bank.a2[j] * c2;
+					const double denImag = bank.a1[j] * s1 + bank.a2[j] * s2;
+					product *= (numReal * numReal + numImag * numImag) / (denReal * denReal + denImag * denImag);
+				}
+
+				db += 10.0 * std::log10(product);
+			}
+
+			response[c * count + i] = db;
+		}
+	}
+}
+
+#else
+
+// The SIMD kernels perform exactly the same operations in the same order as the scalar one,
+// so all the code paths produce bit-identical results.
+
+void evaluateSse2(const FilterBank& bank, const FrequencyGrid& grid, double* response, size_t count)
+{
+	constexpr size_t Width = 2;
+	const size_t vectorEnd = count - count % Width;
+
+	for (size_t i = 0; i < vectorEnd; i += Width)
+	{
+		const __m128d c1 = _mm_loadu_pd(grid.cos1() + i);
+		const __m128d s1 = _mm_loadu_pd(grid.sin1() + i);
+		const __m128d c2 = _mm_loadu_pd(grid.cos2() + i);
+		const __m128d s2 = _mm_loadu_pd(grid.sin2() + i);
+
+		alignas(16) double db[Width] = { bank.gainDb, bank.gainDb };
+		alignas(16) double product[Width];
+
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			__m128d acc = _mm_set1_pd(1.0);
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+			{
+				const __m128d b0 = _mm_set1_pd(bank.b0[k]), b1 = _mm_set1_pd(bank.b1[k]), b2 = _mm_set1_pd(bank.b2[k]);
+				const __m128d a0 = _mm_set1_pd(bank.a0[k]), a1 = _mm_set1_pd(bank.a1[k]), a2 = _mm_set1_pd(bank.a2[k]);
+
+				const __m128d numReal = _mm_add_pd(_mm_add_pd(b0, _mm_mul_pd(b1, c1)), _mm_mul_pd(b2, c2));
+				const __m128d numImag = _mm_add_pd(_mm_mul_pd(b1, s1), _mm_mul_pd(b2, s2));
+				const __m128d denReal = _mm_add_pd(_mm_add_pd(a0, _mm_mul_pd(a1, c1)), _mm_mul_pd(a2, c2));
+				const __m128d denImag = _mm_add_pd(_mm_mul_pd(a1, s1), _mm_mul_pd(a2, s2));
+
+				const __m128d num = _mm_add_pd(_mm_mul_pd(numReal, numReal), _mm_mul_pd(numImag, numImag));
+				const __m128d den = _mm_add_pd(_mm_mul_pd(denReal, denReal), _mm_mul_pd(denImag, denImag));
+				acc = _mm_mul_pd(acc, _mm_div_pd(num, den));
+			}
+
+			_mm_store_pd(product, acc);
+			for (size_t lane = 0; lane < Width; ++lane)
+				db[lane] += 10.0 * std::log10(product[lane]);
+		}
+
+		_mm_storeu_pd(response + i, _mm_load_pd(db));
+	}
+
+	evaluateScalar(bank, grid, response, vectorEnd, count);
+}
+
+TARGET_AVX void evaluateAvx(const FilterBank& bank, const FrequencyGrid& grid, double* response, size_t count)
+{
+	constexpr size_t Width = 4;
+	const size_t vectorEnd = count - count % Width;
+
+	for (size_t i = 0; i < vectorEnd; i += Width)
+	{
+		const __m256d c1 = _mm256_loadu_pd(grid.cos1() + i);
+		const __m256d s1 = _mm256_loadu_pd(grid.sin1() + i);
+		const __m256d c2 = _mm256_loadu_pd(grid.cos2() + i);
+		const __m256d s2 = _mm256_loadu_pd(grid.sin2() + i);
+
+		alignas(32) double db[Width] = { bank.gainDb, bank.gainDb, bank.gainDb, bank.gainDb };
+		alignas(32) double product[Width];
+
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			__m256d acc = _mm256_set1_pd(1.0);
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+			{
+				const __m256d b0 = _mm256_set1_pd(bank.b0[k]), b1 = _mm256_set1_pd(bank.b1[k]), b2 = _mm256_set1_pd(bank.b2[k]);
+				const __m256d a0 = _mm256_set1_pd(bank.a0[k]), a1 = _mm256_set1_pd(bank.a1[k]), a2 = _mm256_set1_pd(bank.a2[k]);
+
+				const __m256d numReal = _mm256_add_pd(_mm256_add_pd(b0, _mm256_mul_pd(b1, c1)), _mm256_mul_pd(b2, c2));
+				const __m256d numImag = _mm256_add_pd(_mm256_mul_pd(b1, s1), _mm256_mul_pd(b2, s2));
+				const __m256d denReal = _mm256_add_pd(_mm256_add_pd(a0, _mm256_mul_pd(a1, c1)), _mm256_mul_pd(a2, c2));
+				const __m256d denImag = _mm256_add_pd(_mm256_mul_pd(a1, s1), _mm256_mul_pd(a2, s2));
+
+				const __m256d num = _mm256_add_pd(_mm256_mul_pd(numReal, numReal), _mm256_mul_pd(numImag, numImag));
+				const __m256d den = _mm256_add_pd(_mm256_mul_pd(denReal, denReal), _mm256_mul_pd(denImag, denImag));
+				acc = _mm256_mul_pd(acc, _mm256_div_pd(num, den));
+			}
+
+			_mm256_store_pd(product, acc);
+			for (size_t lane = 0; lane < Width; ++lane)
+				db[lane] += 10.0 * std::log10(product[lane]);
+		}
+
+		_mm256_storeu_pd(response + i, _mm256_load_pd(db));
+	}
+
+	evaluateScalar(bank, grid, response, vectorEnd, count);
+}
+
+void evaluateFullSse2(const FilterBank& bank, const FrequencyGrid& grid, double* response, double* phase, double* delay, size_t count)
+{
+	constexpr size_t Width = 2;
+	const size_t vectorEnd = count - count % Width;
+	const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), two = _mm_set1_pd(2.0);
+
+	for (size_t i = 0; i < vectorEnd; i += Width)
+	{
+		const __m128d c1 = _mm_loadu_pd(grid.cos1() + i);
+		const __m128d s1 = _mm_loadu_pd(grid.sin1() + i);
+		const __m128d c2 = _mm_loadu_pd(grid.cos2() + i);
+		const __m128d s2 = _mm_loadu_pd(grid.sin2() + i);
+
+		alignas(16) double db[Width] = { bank.gainDb, bank.gainDb };
+		alignas(16) double radians[Width] = {};
+		alignas(16) double product[Width], hReal[Width], hImag[Width];
+		__m128d samples = _mm_setzero_pd();
+
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			__m128d acc = one;
+			__m128d accReal = one, accImag = _mm_setzero_pd();
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+			{
+				const __m128d b0 = _mm_set1_pd(bank.b0[k]), b1 = _mm_set1_pd(bank.b1[k]), b2 = _mm_set1_pd(bank.b2[k]);
+				const __m128d a0 = _mm_set1_pd(bank.a0[k]), a1 = _mm_set1_pd(bank.a1[k]), a2 = _mm_set1_pd(bank.a2[k]);
+
+				const __m128d numReal = _mm_add_pd(_mm_add_pd(b0, _mm_mul_pd(b1, c1)), _mm_mul_pd(b2, c2));
+				const __m128d numImag = _mm_add_pd(_mm_mul_pd(b1, s1), _mm_mul_pd(b2, s2));
+				const __m128d denReal = _mm_add_pd(_mm_add_pd(a0, _mm_mul_pd(a1, c1)), _mm_mul_pd(a2, c2));
+				const __m128d denImag = _mm_add_pd(_mm_mul_pd(a1, s1), _mm_mul_pd(a2, s2));
+
+				const __m128d num = _mm_add_pd(_mm_mul_pd(numReal, numReal), _mm_mul_pd(numImag, numImag));
+				const __m128d den = _mm_add_pd(_mm_mul_pd(denReal, denReal), _mm_mul_pd(denImag, denImag));
+				const __m128d invNum = _mm_and_pd(_mm_cmpgt_pd(num, zero), _mm_div_pd(one, num));
+				const __m128d invDen = _mm_div_pd(one, den);
+				acc = _mm_mul_pd(acc, _mm_mul_pd(num, invDen));
+
+				const __m128d real = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(numReal, denReal), _mm_mul_pd(numImag, denImag)), invDen);
+				const __m128d imag = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(numImag, denReal), _mm_mul_pd(numReal, denImag)), invDen);
+				const __m128d nextReal = _mm_sub_pd(_mm_mul_pd(accReal, real), _mm_mul_pd(accImag, imag));
+				accImag = _mm_add_pd(_mm_mul_pd(accReal, imag), _mm_mul_pd(accImag, real));
+				accReal = nextReal;
+
+				const __m128d numDelay = _mm_add_pd(
+					_mm_mul_pd(_mm_add_pd(_mm_mul_pd(b1, c1), _mm_mul_pd(_mm_mul_pd(two, b2), c2)), numReal),
+					_mm_mul_pd(_mm_add_pd(_mm_mul_pd(b1, s1), _mm_mul_pd(_mm_mul_pd(two, b2), s2)), numImag));
+				const __m128d denDelay = _mm_add_pd(
+					_mm_mul_pd(_mm_add_pd(_mm_mul_pd(a1, c1), _mm_mul_pd(_mm_mul_pd(two, a2), c2)), denReal),
+					_mm_mul_pd(_mm_add_pd(_mm_mul_pd(a1, s1), _mm_mul_pd(_mm_mul_pd(two, a2), s2)), denImag));
+				samples = _mm_add_pd(samples, _mm_sub_pd(_mm_mul_pd(numDelay, invNum), _mm_mul_pd(denDelay, invDen)));
+			}
+
+			_mm_store_pd(product, acc);
+			_mm_store_pd(hReal, accReal);
+			_mm_store_pd(hImag, accImag);
+			for (size_t lane = 0; lane < Width; ++lane)
+			{
+				db[lane] += 10.0 * std::log10(product[lane]);
+				radians[lane] -= std::atan2(hImag[lane], hReal[lane]);
+			}
+		}
+
+		_mm_storeu_pd(response + i, _mm_load_pd(db));
+		_mm_storeu_pd(phase + i, _mm_load_pd(radians));
+		_mm_storeu_pd(delay + i, samples);
+	}
+
+	evaluateFullScalar(bank, grid, response, phase, delay, vectorEnd, count);
+}
+
+TARGET_AVX void evaluateFullAvx(const FilterBank& bank, const FrequencyGrid& grid, double* response, double* phase, double* delay, size_t count)
+{
+	constexpr size_t Width = 4;
+	const size_t vectorEnd = count - count % Width;
+	const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0);
+
+	for (size_t i = 0; i < vectorEnd; i += Width)
+	{
+		const __m256d c1 = _mm256_loadu_pd(grid.cos1() + i);
+		const __m256d s1 = _mm256_loadu_pd(grid.sin1() + i);
+		const __m256d c2 = _mm256_loadu_pd(grid.cos2() + i);
+		const __m256d s2 = _mm256_loadu_pd(grid.sin2() + i);
+
+		alignas(32) double db[Width] = { bank.gainDb, bank.gainDb, bank.gainDb, bank.gainDb };
+		alignas(32) double radians[Width] = {};
+		alignas(32) double product[Width], hReal[Width], hImag[Width];
+		__m256d samples = _mm256_setzero_pd();
+
+		for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+		{
+			__m256d acc = one;
+			__m256d accReal = one, accImag = _mm256_setzero_pd();
+			for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+			{
+				const __m256d b0 = _mm256_set1_pd(bank.b0[k]), b1 = _mm256_set1_pd(bank.b1[k]), b2 = _mm256_set1_pd(bank.b2[k]);
+				const __m256d a0 = _mm256_set1_pd(bank.a0[k]), a1 = _mm256_set1_pd(bank.a1[k]), a2 = _mm256_set1_pd(bank.a2[k]);
+
+				const __m256d numReal = _mm256_add_pd(_mm256_add_pd(b0, _mm256_mul_pd(b1, c1)), _mm256_mul_pd(b2, c2));
+				const __m256d numImag = _mm256_add_pd(_mm256_mul_pd(b1, s1), _mm256_mul_pd(b2, s2));
+				const __m256d denReal = _mm256_add_pd(_mm256_add_pd(a0, _mm256_mul_pd(a1, c1)), _mm256_mul_pd(a2, c2));
+				const __m256d denImag = _mm256_add_pd(_mm256_mul_pd(a1, s1), _mm256_mul_pd(a2, s2));
+
+				const __m256d num = _mm256_add_pd(_mm256_mul_pd(numReal, numReal), _mm256_mul_pd(numImag, numImag));
+				const __m256d den = _mm256_add_pd(_mm256_mul_pd(denReal, denReal), _mm256_mul_pd(denImag, denImag));
+				const __m256d invNum = _mm256_and_pd(_mm256_cmp_pd(num, zero, _CMP_GT_OQ), _mm256_div_pd(one, num));
+				const __m256d invDen = _mm256_div_pd(one, den);
+				acc = _mm256_mul_pd(acc, _mm256_mul_pd(num, invDen));
+
+				const __m256d real = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(numReal, denReal), _mm256_mul_pd(numImag, denImag)), invDen);
+				const __m256d imag = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(numImag, denReal), _mm256_mul_pd(numReal, denImag)), invDen);
+				const __m256d nextReal = _mm256_sub_pd(_mm256_mul_pd(accReal, real), _mm256_mul_pd(accImag, imag));
+				accImag = _mm256_add_pd(_mm256_mul_pd(accReal, imag), _mm256_mul_pd(accImag, real));
+				accReal = nextReal;
+
+				const __m256d numDelay = _mm256_add_pd(
+					_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(b1, c1), _mm256_mul_pd(_mm256_mul_pd(two, b2), c2)), numReal),
+					_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(b1, s1), _mm256_mul_pd(_mm256_mul_pd(two, b2), s2)), numImag));
+				const __m256d denDelay = _mm256_add_pd(
+					_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(a1, c1), _mm256_mul_pd(_mm256_mul_pd(two, a2), c2)), denReal),
+					_mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(a1, s1), _mm256_mul_pd(_mm256_mul_pd(two, a2), s2)), denImag));
+				samples = _mm256_add_pd(samples, _mm256_sub_pd(_mm256_mul_pd(numDelay, invNum), _mm256_mul_pd(denDelay, invDen)));
+			}
+
+			_mm256_store_pd(product, acc);
+			_mm256_store_pd(hReal, accReal);
+			_mm256_store_pd(hImag, accImag);
+			for (size_t lane = 0; lane < Width; ++lane)
+			{
+				db[lane] += 10.0 * std::log10(product[lane]);
+				radians[lane] -= std::atan2(hImag[lane], hReal[lane]);
+			}
+		}
+
+		_mm256_storeu_pd(response + i, _mm256_load_pd(db));
+		_mm256_storeu_pd(phase + i, _mm256_load_pd(radians));
+		_mm256_storeu_pd(delay + i, samples);
+	}
+
+	evaluateFullScalar(bank, grid, response, phase, delay, vectorEnd, count);
+}
+
+// One channel per lane, the frequency points are walked one at a time. The chains are padded to the same length,
+// so a chain's sections are grouped by MaxFiltersPerProduct exactly like in a mono bank and the padding only ever
+// multiplies the products by 1. MaxChannels is a multiple of the width, the loads never go past the end of a section.
+void evaluateChannelsSse2(const ChannelFilterBank& bank, const FrequencyGrid& grid, double* response)
+{
+	constexpr size_t Width = 2;
+	const size_t count = grid.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m128d c1 = _mm_set1_pd(grid.cos1()[i]);
+		const __m128d s1 = _mm_set1_pd(grid.sin1()[i]);
+		const __m128d c2 = _mm_set1_pd(grid.cos2()[i]);
+		const __m128d s2 = _mm_set1_pd(grid.sin2()[i]);
+
+		for (size_t channel = 0; channel < bank.channelCount; channel += Width)
+		{
+			alignas(16) double db[Width] = { bank.gainDb[channel], bank.gainDb[channel + 1] };
+			alignas(16) double product[Width];
+
+			for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+			{
+				__m128d acc = _mm_set1_pd(1.0);
+				for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+				{
+					const size_t j = k * MaxChannels + channel;
+					const __m128d b0 = _mm_loadu_pd(&bank.b0[j]), b1 = _mm_loadu_pd(&bank.b1[j]), b2 = _mm_loadu_pd(&bank.b2[j]);
+					const __m128d a0 = _mm_loadu_pd(&bank.a0[j]), a1 = _mm_loadu_pd(&bank.a1[j]), a2 = _mm_loadu_pd(&bank.a2[j]);
+
+					const __m128d numReal = _mm_add_pd(_mm_add_pd(b0, _mm_mul_pd(b1, c1)), _mm_mul_pd(b2, c2));
+					const __m128d numImag = _mm_add_pd(_mm_mul_pd(b1, s1), _mm_mul_pd(b2, s2));
+					const __m128d denReal = _mm_add_pd(_mm_add_pd(a0, _mm_mul_pd(a1, c1)), _mm_mul_pd(a2, c2));
+					const __m128d denImag = _mm_add_pd(_mm_mul_pd(a1, s1), _mm_mul_pd(a2, s2));
+
+					const __m128d num = _mm_add_pd(_mm_mul_pd(numReal, numReal), _mm_mul_pd(numImag, numImag));
+					const __m128d den = _mm_add_pd(_mm_mul_pd(denReal, denReal), _mm_mul_pd(denImag, denImag));
+					acc = _mm_mul_pd(acc, _mm_div_pd(num, den));
+				}
+
+				_mm_store_pd(product, acc);
+				for (size_t lane = 0; lane < Width; ++lane)
+					db[lane] += 10.0 * std::log10(product[lane]);
+			}
+
+			for (size_t lane = 0; lane < Width && channel + lane < bank.channelCount; ++lane)
+				response[(channel + lane) * count + i] = db[lane];
+		}
+	}
+}
+
+TARGET_AVX void evaluateChannelsAvx(const ChannelFilterBank& bank, const FrequencyGrid& grid, double* response)
+{
+	constexpr size_t Width = 4;
+	const size_t count = grid.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m256d c1 = _mm256_set1_pd(grid.cos1()[i]);
+		const __m256d s1 = _mm256_set1_pd(grid.sin1()[i]);
+		const __m256d c2 = _mm256_set1_pd(grid.cos2()[i]);
+		const __m256d s2 = _mm256_set1_pd(grid.sin2()[i]);
+
+		for (size_t channel = 0; channel < bank.channelCount; channel += Width)
+		{
+			alignas(32) double db[Width] = { bank.gainDb[channel], bank.gainDb[channel + 1], bank.gainDb[channel + 2], bank.gainDb[channel + 3] };
+			alignas(32) double product[Width];
+
+			for (size_t first = 0, n = bank.size(); first < n; first += MaxFiltersPerProduct)
+			{
+				__m256d acc = _mm256_set1_pd(1.0);
+				for (size_t k = first, last = std::min(n, first + MaxFiltersPerProduct); k < last; ++k)
+				{
+					const size_t j = k * MaxChannels + channel;
+					const __m256d b0 = _mm256_loadu_pd(&bank.b0[j]), b1 = _mm256_loadu_pd(&bank.b1[j]), b2 = _mm256_loadu_pd(&bank.b2[j]);
+					const __m256d a0 = _mm256_loadu_pd(&bank.a0[j]), a1 = _mm256_loadu_pd(&bank.a1[j]), a2 = _mm256_loadu_pd(&bank.a2[j]);
+
+					const __m256d numReal = _mm256_add_pd(_mm256_add_pd(b0, _mm256_mul_pd(b1, c1)), _mm256_mul_pd(b2, c2));
+					const __m256d numImag = _mm256_add_pd(_mm256_mul_pd(b1, s1), _mm256_mul_pd(b2, s2));
+					const __m256d denReal = _mm256_add_pd(_mm256_add_pd(a0, _mm256_mul_pd(a1, c1)), _mm256_mul_pd(a2, c2));
+					const __m256d denImag = _mm256_add_pd(_mm256_mul_pd(a1, s1), _mm256_mul_pd(a2, s2));
+
+					const __m256d num = _mm256_add_pd(_mm256_mul_pd(numReal, numReal), _mm256_mul_pd(numImag, numImag));
+					const __m256d den = _mm256_add_pd(_mm256_mul_pd(denReal, denReal), _mm256_mul_pd(denImag, denImag));
+					acc = _mm256_mul_pd(acc, _mm256_div_pd(num, den));
+				}
+
+				_mm256_store_pd(product, acc);
+				for (size_t lane = 0; lane < Width; ++lane)
+					db[lane] += 10.0 * std::log10(product[lane]);
+			}
+
+			for (size_t lane = 0; lane < Width && channel + lane < bank.channelCount; ++lane)
+				response[(channel + lane) * count + i] = db[lane];
+		}
+	}
+}
+
+bool cpuSupportsAvx()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	const bool osXsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	// The OS must also preserve the YMM registers on context switch
+	return osXsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif // FREQUENCY_RESPONSE_X86_SIMD
+
+using ResponseKernel = void (*)(const FilterBank&, const FrequencyGrid&, double*, size_t);
+using ChannelResponseKernel = void (*)(const ChannelFilterBank&, const FrequencyGrid&, double*);
+using FullResponseKernel = void (*)(const FilterBank&, const FrequencyGrid&, double*, double*, double*, size_t);
+
+ResponseKernel selectKernel()
+{
+#ifdef FREQUENCY_RESPONSE_X86_SIMD
+	return cpuSupportsAvx() ? &evaluateAvx : &evaluateSse2;
+#else
+	return &evaluateScalar;
+#endif
+}
+
+FullResponseKernel selectFullKernel()
+{
+#ifdef FREQUENCY_RESPONSE_X86_SIMD
+	return cpuSupportsAvx() ? &evaluateFullAvx : &evaluateFullSse2;
+#else
+	return &evaluateFullScalar;
+#endif
+}
+
+ChannelResponseKernel selectChannelKernel()
+{
+#ifdef FREQUENCY_RESPONSE_X86_SIMD
+	return cpuSupportsAvx() ? &evaluateChannelsAvx : &evaluateChannelsSse2;
+#else
+	return &evaluateChannelsScalar;
+#endif
+}
+
+} // namespace
+
+void calculateFrequencyResponse(const FilterBank& bank, const FrequencyGrid& grid, double* response)
+{
+	static const ResponseKernel kernel = selectKernel();
+	kernel(bank, grid, response, grid.size());
+}
+
+void calculateChannelResponses(const ChannelFilterBank& bank, const FrequencyGrid& grid, double* response)
+{
+	static const ChannelResponseKernel kernel = selectChannelKernel();
+	kernel(bank, grid, response);
+}
+
+ResponseTraces calculateFullResponse(const FilterBank& bank, const FrequencyGrid& grid)
+{
+	static const FullResponseKernel kernel = selectFullKernel();
+
+	const size_t count = grid.size();
+	ResponseTraces traces;
+	traces.magnitudeDb.resize(count);
+	traces.phaseDegrees.resize(count);
+	traces.groupDelayMs.resize(count);
+	kernel(bank, grid, traces.magnitudeDb.data(), traces.phaseDegrees.data(), traces.groupDelayMs.data(), count);
+
+	// Every product's phase is wrapped to (-pi, pi], the sum is unwrapped along the grid
+	double offset = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		double radians = traces.phaseDegrees[i] + offset;
+		if (i > 0)
+		{
+			const double previous = traces.phaseDegrees[i - 1] * M_PI / 180.0;
+			const double turns = std::round((radians - previous) / (2.0 * M_PI));
+			offset -= turns * 2.0 * M_PI;
+			radians -= turns * 2.0 * M_PI;
+		}
+
+		traces.phaseDegrees[i] = radians * 180.0 / M_PI;
+		traces.groupDelayMs[i] *= 1000.0 / grid.sampleRate();
+	}
+
+	return traces;
+}
@@ -2,6 +2,7 @@
 
 #include "Filter.h"
 
+#include <array>
 #include <vector>
 #include <cmath>
 
@@ -35,6 +36,77 @@ inline BiquadCoefficients calculatePeakingCoefficients(double fc, double gain, d
 	return coef;
 }
 
+// Biquad coefficients of any RBJ filter type, the branch for the type is selected at compile time.
+// The gain is ignored by the types that don't have one.
+template<BiquadType Type>
+inline BiquadCoefficients calculateBiquadCoefficients(double fc, double gain, double q, double sampleRate = 48000.0)
+{
+	if constexpr (Type == BiquadType::Peaking)
+	{
+		return calculatePeakingCoefficients(fc, gain, q, sampleRate);
+	}
+	else if constexpr (biquadTraits(Type).hasGain)
+	{
+		const double A = std::pow(10.0, gain / 40.0);
+		// LS and HS are given by their corner frequency, the natural frequency of the poles, which is sqrt(A) times
+		// below (LS) or above (HS) the midpoint frequency of the RBJ formulas. LSC and HSC take the midpoint.
+		const double f0 = Type == BiquadType::LowShelf ? fc * std::sqrt(A) : Type == BiquadType::HighShelf ? fc / std::sqrt(A) : fc;
+		const double omega = 2.0 * M_PI * f0 / sampleRate;
+		const double sn = std::sin(omega);
+		const double cs = std::cos(omega);
+		// LS and HS take the shelf slope S instead of a Q
+		const double alpha = Type == BiquadType::LowShelf || Type == BiquadType::HighShelf
+			? sn / 2.0 * std::sqrt((A + 1.0 / A) * (1.0 / q - 1.0) + 2.0)
+			: sn / (2.0 * q);
+		const double twoSqrtAAlpha = 2.0 * std::sqrt(A) * alpha;
+
+		if constexpr (Type == BiquadType::LowShelf || Type == BiquadType::LowShelfCenter)
+		{
+			return {
+				A * ((A + 1.0) - (A - 1.0) * cs + twoSqrtAAlpha),
+				2.0 * A * ((A - 1.0) - (A + 1.0) * cs),
+				A * ((A + 1.0) - (A - 1.0) * cs - twoSqrtAAlpha),
+				(A + 1.0) + (A - 1.0) * cs + twoSqrtAAlpha,
+				-2.0 * ((A - 1.0) + (A + 1.0) * cs),
+				(A + 1.0) + (A - 1.0) * cs - twoSqrtAAlpha
+			};
+		}
+		else
+		{
+			return {
+				A * ((A + 1.0) + (A - 1.0) * cs + twoSqrtAAlpha),
+				-2.0 * A * ((A - 1.0) + (A + 1.0) * cs),
+				A * ((A + 1.0) + (A - 1.0) * cs - twoSqrtAAlpha),
+				(A + 1.0) - (A - 1.0) * cs + twoSqrtAAlpha,
+				2.0 * ((A - 1.0) - (A + 1.0) * cs),
+				(A + 1.0) - (A - 1.0) * cs - twoSqrtAAlpha
+			};
+		}
+	}
+	else
+	{
+		const double omega = 2.0 * M_PI * fc / sampleRate;
+		const double sn = std::sin(omega);
+		const double cs = std::cos(omega);
+		const double alpha = sn / (2.0 * q);
+		const double a0 = 1.0 + alpha, a1 = -2.0 * cs, a2 = 1.0 - alpha;
+
+		if constexpr (Type == BiquadType::LowPass)
+			return { (1.0 - cs) / 2.0, 1.0 - cs, (1.0 - cs) / 2.0, a0, a1, a2 };
+		else if constexpr (Type == BiquadType::HighPass)
+			return { (1.0 + cs) / 2.0, -(1.0 + cs), (1.0 + cs) / 2.0, a0, a1, a2 };
+		else if constexpr (Type == BiquadType::BandPass)
+			return { alpha, 0.0, -alpha, a0, a1, a2 }; // 0 dB peak gain
+		else if constexpr (Type == BiquadType::Notch)
+			return { 1.0, -2.0 * cs, 1.0, a0, a1, a2 };
+		else
+		{
+			static_assert(Type == BiquadType::AllPass);
+			return { 1.0 - alpha, -2.0 * cs, 1.0 + alpha, a0, a1, a2 };
+		}
+	}
+}
+
 // Calculate magnitude response of a biquad filter at a given frequency
 inline double calculateMagnitudeResponse(const BiquadCoefficients& coef, double frequency, double sampleRate = 48000.0)
 {
@@ -56,39 +128,101 @@ inline double calculateMagnitudeResponse(const BiquadCoefficients& coef, double
 	return 20.0 * std::log10(numMag / denMag);
 }
 
+// A set of frequency points together with the trig basis of each point for the given sample rate.
+// Building the grid is the only place where sin/cos are evaluated, so it should be reused for as long
+// as the frequencies stay the same.
+class FrequencyGrid {
+public:
+	FrequencyGrid() = default;
+	explicit FrequencyGrid(std::vector<double> frequencies, double sampleRate = 48000.0);
+
+	// Logarithmically-spaced frequencies from minFreq to maxFreq
+	[[nodiscard]] static FrequencyGrid logarithmic(size_t numPoints, double minFreq = 15.0, double maxFreq = 20000.0, double sampleRate = 48000.0);
+
+	[[nodiscard]] size_t size() const { return _frequencies.size(); }
+	[[nodiscard]] bool empty() const { return _frequencies.empty(); }
+	[[nodiscard]] double sampleRate() const { return _sampleRate; }
+	[[nodiscard]] const std::vector<double>& frequencies() const { return _frequencies; }
+
+	// cos(w), sin(w), cos(2w) and sin(2w) of every point, w = 2*pi*f/fs
+	[[nodiscard]] const double* cos1() const { return _cos1.data(); }
+	[[nodiscard]] const double* sin1() const { return _sin1.data(); }
+	[[nodiscard]] const double* cos2() const { return _cos2.data(); }
+	[[nodiscard]] const double* sin2() const { return _sin2.data(); }
+
+private:
+	std::vector<double> _frequencies;
+	std::vector<double> _cos1, _sin1, _cos2, _sin2;
+	double _sampleRate = 48000.0;
+};
+
+// Enabled filters of a profile packed as a structure of arrays (one array per biquad coefficient)
+// so that the response kernel can evaluate several frequency points per instruction
+struct FilterBank {
+	std::vector<double> b0, b1, b2;
+	std::vector<double> a0, a1, a2;
+	double gainDb = 0.0; // Sum of all the enabled preamps
+
+	[[nodiscard]] size_t size() const { return b0.size(); }
+	void addBiquad(const BiquadCoefficients& coef);
+	// Adds the filter if it's enabled; unsupported filters are ignored
+	void addFilter(const Filter& filter, double sampleRate = 48000.0);
+	void append(const FilterBank& other);
+
+	bool operator==(const FilterBank& other) const = default;
+
+	[[nodiscard]] static FilterBank fromFilter(const Filter& filter, double sampleRate = 48000.0);
+	[[nodiscard]] static FilterBank fromFilters(const FilterList& filters, double sampleRate = 48000.0);
+};
+
+// Everything calculateFullResponse() returns, one value per point of the grid
+struct ResponseTraces {
+	std::vector<double> magnitudeDb;
+	std::vector<double> phaseDegrees; // Unwrapped along the grid
+	std::vector<double> groupDelayMs;
+};
+
+// The chains of up to MaxChannels channels interleaved so that the response kernel evaluates one channel per lane
+// and every point costs about the same as in a mono chain. Section k of channel c is at [k * MaxChannels + c], the
+// shorter chains and the unused channels are padded with pass-through sections.
+struct ChannelFilterBank {
+	std::vector<double> b0, b1, b2;
+	std::vector<double> a0, a1, a2;
+	std::array<double, MaxChannels> gainDb{};
+	size_t channelCount = 0;
+
+	// The number of sections of the longest chain
+	[[nodiscard]] size_t size() const { return b0.size() / MaxChannels; }
+
+	[[nodiscard]] static ChannelFilterBank fromFilters(const ChannelFilterList& filters, double sampleRate = 48000.0);
+};
+
+// Calculate combined frequency response (in dB) of the filter bank at every point of the grid.
+// The squared magnitudes of the cascade are multiplied together and converted to dB once per point.
+// Uses AVX or SSE2 when the CPU supports it, with a scalar fallback.
+void calculateFrequencyResponse(const FilterBank& bank, const FrequencyGrid& grid, double* response);
+
+// Calculate the magnitude, the phase and the analytic group delay of the filter bank in the same pass, from a single
+// evaluation of every biquad's numerator and denominator. The magnitude agrees with calculateFrequencyResponse() to
+// rounding. The preamp only adds to the magnitude.
+[[nodiscard]] ResponseTraces calculateFullResponse(const FilterBank& bank, const FrequencyGrid& grid);
+
+// Calculate the response of every channel of the bank, channel after channel: response[c * grid.size() + i].
+// Each channel's curve is bit-identical to the one of its chain evaluated on its own.
+void calculateChannelResponses(const ChannelFilterBank& bank, const FrequencyGrid& grid, double* response);
+
 // Calculate combined frequency response for all filters
+inline std::vector<double> calculateFrequencyResponse(const FilterList& filters, const FrequencyGrid& grid)
+{
+	std::vector<double> response(grid.size(), 0.0);
+	calculateFrequencyResponse(FilterBank::fromFilters(filters, grid.sampleRate()), grid, response.data());
+	return response;
+}
+
 inline std::vector<double> calculateFrequencyResponse(
-	const std::vector<FilterUniquePtr>& filters,
+	const FilterList& filters,
 	const std::vector<double>& frequencies,
 	double sampleRate = 48000.0)
 {
-	std::vector<double> response(frequencies.size(), 0.0);
-
-	for (const auto& filter : filters)
-	{
-		if (!filter->isEnabled())
-			continue;
-
-		if (auto* preamp = dynamic_cast<PreampFilter*>(filter.get()))
-		{
-			// Preamp just adds a constant gain
-			for (size_t i = 0; i < response.size(); ++i)
-				response[i] += preamp->gain();
-		}
-		else if (auto* pk = dynamic_cast<PeakingFilter*>(filter.get()))
-		{
-			// Calculate biquad coefficients
-			auto coef = calculatePeakingCoefficients(pk->fc(), pk->gain(), pk->q(), sampleRate);
-
-			// Add this filter's response to the total
-			for (size_t i = 0; i < frequencies.size(); ++i)
-			{
-				double mag = calculateMagnitudeResponse(coef, frequencies[i], sampleRate);
-				response[i] += mag;
-			}
-		}
-		// Unsupported filters are ignored
-	}
-
-	return response;
+	return calculateFrequencyResponse(filters, FrequencyGrid{ frequencies, sampleRate });
 }
@@ -1,9 +1,9 @@
 #include "FrequencyResponseWidget.h"
-#include "FrequencyResponse.h"
 
 #include <QPainter>
 #include <QPen>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 
@@ -12,22 +12,18 @@ inline constexpr int MarginRight = 5;
 inline constexpr int MarginTop = 5;
 inline constexpr int MarginBottom = 25;
 
-// Generate logarithmically-spaced frequencies from 20 Hz to 20 kHz
-inline void generateLogFrequencies(std::vector<double>& frequencies, size_t numPoints)
-{
-	frequencies.resize(numPoints);
+inline constexpr double MinFrequency = 15.0;
+inline constexpr double MaxFrequency = 20000.0;
+// The stopbands of the pass filters and the notches go down towards -inf, the curve is clipped there
+inline constexpr double MinDisplayDb = -36.0;
 
-	const double minFreq = 15.0;
-	const double maxFreq = 20000.0;
-	const double logMin = std::log10(minFreq);
-	const double logMax = std::log10(maxFreq);
+// The first one is the color of the single curve
+inline const std::array<QColor, MaxChannels> ChannelColors{
+	QColor(0, 120, 215), QColor(215, 40, 40), QColor(40, 160, 60), QColor(230, 140, 0),
+	QColor(130, 60, 190), QColor(0, 160, 160), QColor(140, 90, 40), QColor(210, 60, 160)
+};
 
-	for (size_t i = 0; i < numPoints; ++i)
-	{
-		double logFreq = logMin + (logMax - logMin) * i / (numPoints - 1);
-		frequencies[i] = std::pow(10.0, logFreq);
-	}
-}
+inline const QColor SecondaryTraceColor(230, 120, 0);
 
 inline double dbToY(double db, double minDb, double maxDb)
 {
@@ -35,66 +31,392 @@ inline double dbToY(double db, double minDb, double maxDb)
 	return 1.0 - (db - minDb) / (maxDb - minDb);
 }
 
+// Channel after channel, empty if the chain isn't channel-scoped
+inline std::vector<double> calculateChannelCurves(const ChannelFilterList& filters, const FrequencyGrid& grid)
+{
+	std::vector<double> responses(filters.channelCount() * grid.size());
+	if (!responses.empty())
+		calculateChannelResponses(ChannelFilterBank::fromFilters(filters, grid.sampleRate()), grid, responses.data());
+	return responses;
+}
+
 FrequencyResponseWidget::FrequencyResponseWidget(QWidget* parent) :
 	QWidget(parent)
 {
 	setMinimumHeight(200);
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::MinimumExpanding);
 
-	_response.resize(_frequencies.size(), 0.0);
+	// A single worker is enough: a new request makes all the older ones obsolete
+	_workerPool.setMaxThreadCount(1);
 }
 
-void FrequencyResponseWidget::setFilters(const std::vector<FilterUniquePtr>& filters)
+FrequencyResponseWidget::~FrequencyResponseWidget()
+{
+	++_generation; // Cancel the calculation in progress, if any
+	++_secondaryGeneration;
+	++_channelGeneration;
+	_workerPool.clear();
+	_workerPool.waitForDone();
+}
+
+void FrequencyResponseWidget::setFilters(const FilterList& filters)
 {
 	_filters = &filters;
 
+	++_generation; // The results calculated for the previous filters are no longer relevant
 	_response.clear();
-	_frequencies.clear(); // Will be regenerated in paintEvent
+	_contributions.clear();
+	_grid = {};
+	_curvePoints.clear();
+	_requestedPoints = -1; // Will be requested in paintEvent
 
 	update();
 }
 
 void FrequencyResponseWidget::updateResponse()
 {
-	assert(_frequencies.size() > 1);
+	requestResponse(width() - MarginLeft - MarginRight);
+}
+
+void FrequencyResponseWidget::requestResponse(int numPoints)
+{
+	_requestedPoints = numPoints;
+
+	Response result;
+	result.generation = ++_generation;
+	// The pending secondary traces and channel curves are for the old grid, the response comes with its own
+	result.secondaryGeneration = ++_secondaryGeneration;
+	result.channelGeneration = ++_channelGeneration;
+
+	// The worker must not touch the filters, they are edited on this thread
+	if (_filters)
+	{
+		result.banks.reserve(_filters->size());
+		for (const Filter& filter : *_filters)
+			result.banks.push_back(FilterBank::fromFilter(filter));
+	}
+
+	_workerPool.clear(); // Drop the obsolete requests that haven't started yet
+	_workerPool.start([this, numPoints, trace = _secondaryTrace, channels = _channelFilters, result{ std::move(result) }]() mutable {
+		if (_generation != result.generation)
+			return;
+
+		result.grid = FrequencyGrid::logarithmic(static_cast<size_t>(std::max(numPoints, 2)), MinFrequency, MaxFrequency);
+
+		FilterBank cascade;
+		for (const FilterBank& bank : result.banks)
+			cascade.append(bank);
+
+		if (_generation != result.generation)
+			return;
+
+		if (trace == SecondaryTrace::None)
+		{
+			result.db.resize(result.grid.size());
+			calculateFrequencyResponse(cascade, result.grid, result.db.data());
+		}
+		else
+		{
+			// The magnitude comes out of the same pass as the phase and the delay
+			ResponseTraces traces = calculateFullResponse(cascade, result.grid);
+			result.db = std::move(traces.magnitudeDb);
+			result.secondary = std::move(trace == SecondaryTrace::Phase ? traces.phaseDegrees : traces.groupDelayMs);
+		}
+
+		result.channelDb = calculateChannelCurves(channels, result.grid);
+
+		QMetaObject::invokeMethod(this, [this, result{ std::move(result) }]() mutable {
+			onResponseReady(std::move(result));
+		}, Qt::QueuedConnection);
+	});
+}
+
+void FrequencyResponseWidget::onResponseReady(Response response)
+{
+	if (response.generation != _generation)
+		return; // A newer request has been made since
+
+	_grid = std::move(response.grid);
+	_response = std::move(response.db);
+	_curvePointsWidth = -1; // The new grid needs new x coordinates
+
+	// Only remember the parameters; the per-filter curves are calculated lazily when a filter is edited
+	_contributions.clear();
+	_contributions.resize(response.banks.size());
+	for (size_t i = 0; i < response.banks.size(); ++i)
+		_contributions[i].bank = std::move(response.banks[i]);
+
+	// The trace may have been switched or the channels edited while the response was being calculated,
+	// the requests made since then were for the old grid
+	if (response.secondaryGeneration == _secondaryGeneration)
+		setSecondary(std::move(response.secondary));
+	else
+		requestSecondaryTrace();
+
+	if (response.channelGeneration == _channelGeneration)
+		_channelResponses = std::move(response.channelDb);
+	else
+	{
+		_channelResponses.clear(); // On the old grid
+		requestChannelResponses();
+	}
+
+	updateDbRange();
+	// Applies the edits made while the response was being calculated
+	syncFilters();
+}
+
+void FrequencyResponseWidget::setChannelFilters(ChannelFilterList filters)
+{
+	// Called on every edit, most of which don't touch a channel-scoped chain
+	if (filters == _channelFilters)
+		return;
+
+	_channelFilters = std::move(filters);
+	requestChannelResponses();
+}
+
+void FrequencyResponseWidget::setSecondaryTrace(SecondaryTrace trace)
+{
+	_secondaryTrace = trace;
+	requestSecondaryTrace();
+	update();
+}
+
+void FrequencyResponseWidget::requestSecondaryTrace()
+{
+	const uint64_t generation = ++_secondaryGeneration;
+	if (_secondaryTrace == SecondaryTrace::None || _grid.size() < 2)
+	{
+		_secondary.clear(); // Calculated along with the response when it arrives
+		return;
+	}
+
+	// The whole chain in one pass, the phase doesn't add up per filter once it's unwrapped.
+	// The banks of the contributions are the current filters, already on the grid's sample rate.
+	FilterBank cascade;
+	for (const FilterContribution& contribution : _contributions)
+		cascade.append(contribution.bank);
+
+	// The pool isn't cleared as that would drop a pending response request, the obsolete traces return straight away
+	_workerPool.start([this, generation, trace = _secondaryTrace, grid = _grid, cascade{ std::move(cascade) }]() {
+		if (_secondaryGeneration != generation)
+			return;
+
+		ResponseTraces traces = calculateFullResponse(cascade, grid);
+		std::vector<double> secondary = std::move(trace == SecondaryTrace::Phase ? traces.phaseDegrees : traces.groupDelayMs);
+
+		QMetaObject::invokeMethod(this, [this, generation, secondary{ std::move(secondary) }]() mutable {
+			if (generation != _secondaryGeneration)
+				return; // The filters or the trace have changed since
+
+			setSecondary(std::move(secondary));
+			update();
+		}, Qt::QueuedConnection);
+	});
+}
+
+void FrequencyResponseWidget::setSecondary(std::vector<double> secondary)
+{
+	_secondary = std::move(secondary);
+	if (_secondary.empty())
+		return;
 
-	if (!_filters)
+	// Rounded to whole quarter turns or to steps of milliseconds that suit the range
+	auto [minIt, maxIt] = std::minmax_element(_secondary.begin(), _secondary.end());
+	const double step = _secondaryTrace == SecondaryTrace::Phase ? 90.0 : (*maxIt - *minIt > 5.0 ? 1.0 : 0.1);
+	_secondaryMin = std::floor(*minIt / step) * step;
+	_secondaryMax = std::max(std::ceil(*maxIt / step) * step, _secondaryMin + step);
+}
+
+void FrequencyResponseWidget::requestChannelResponses()
+{
+	const uint64_t generation = ++_channelGeneration;
+	if (_grid.size() < 2)
+		return; // Calculated along with the response when it arrives
+
+	if (_channelFilters.channelCount() == 0)
 	{
-		std::fill(_response.begin(), _response.end(), 0.0);
-		_minDb = -12.0;
-		_maxDb = 12.0;
+		_channelResponses.clear();
+		updateDbRange();
 		update();
 		return;
 	}
 
-	_response = calculateFrequencyResponse(*_filters, _frequencies);
+	// Like the secondary traces, the obsolete requests return straight away
+	_workerPool.start([this, generation, channels = _channelFilters, grid = _grid]() {
+		if (_channelGeneration != generation)
+			return;
 
-	// Calculate dynamic min and max dB values
-	auto [minIt, maxIt] = std::minmax_element(_response.begin(), _response.end());
-	_minDb = std::floor(*minIt);
-	_maxDb = std::ceil(*maxIt);
+		std::vector<double> channelResponses = calculateChannelCurves(channels, grid);
+
+		QMetaObject::invokeMethod(this, [this, generation, channelResponses{ std::move(channelResponses) }]() mutable {
+			if (generation != _channelGeneration)
+				return;
 
+			_channelResponses = std::move(channelResponses);
+			updateDbRange();
+			update();
+		}, Qt::QueuedConnection);
+	});
+}
+
+void FrequencyResponseWidget::updateFilters(const std::vector<size_t>& filterIndices)
+{
+	if (!_filters || _grid.size() < 2)
+	{
+		update(); // Nothing to update incrementally until the full response arrives
+		return;
+	}
+
+	if (_contributions.size() != _filters->size())
+	{
+		syncFilters();
+		return;
+	}
+
+	for (const size_t index : filterIndices)
+		replaceContribution(_contributions[index], FilterBank::fromFilter((*_filters)[index], _grid.sampleRate()));
+
+	updateDbRange();
+	requestSecondaryTrace();
 	update();
 }
 
-void FrequencyResponseWidget::paintEvent(QPaintEvent* /*event*/)
+void FrequencyResponseWidget::syncFilters()
 {
-	QPainter painter(this);
-	painter.setRenderHint(QPainter::Antialiasing);
+	if (!_filters || _grid.size() < 2)
+	{
+		update(); // Nothing to update incrementally until the full response arrives
+		return;
+	}
+
+	auto previous = std::move(_contributions);
+	std::vector<bool> reused(previous.size(), false);
+	bool changed = false; // Moving filters around doesn't change the cascade
 
-	// Fill background
-	painter.fillRect(rect(), Qt::white);
+	_contributions.clear();
+	_contributions.reserve(_filters->size());
 
-	const auto canvasWidth = width() - MarginLeft - MarginRight;
+	for (size_t i = 0, n = _filters->size(); i < n; ++i)
+	{
+		FilterBank bank = FilterBank::fromFilter((*_filters)[i], _grid.sampleRate());
+
+		// Filters are stored by value, so a filter is identified by its parameters: the ones that have only
+		// moved within the list after an insertion or removal keep their cached contribution.
+		// The same position is checked first as that's where an unchanged filter is most likely to be.
+		auto matches = [&](size_t j) { return !reused[j] && previous[j].bank == bank; };
+		size_t match = i < previous.size() && matches(i) ? i : previous.size();
+		for (size_t j = 0; match == previous.size() && j < previous.size(); ++j)
+		{
+			if (matches(j))
+				match = j;
+		}
+
+		if (match != previous.size())
+		{
+			reused[match] = true;
+			_contributions.push_back(std::move(previous[match]));
+		}
+		else
+		{
+			// A new or edited filter starts with a zero contribution
+			changed = true;
+			FilterContribution contribution;
+			replaceContribution(contribution, std::move(bank));
+			_contributions.push_back(std::move(contribution));
+		}
+	}
 
-	if (canvasWidth != _frequencies.size())
+	// Whatever is left has been removed from the profile or replaced by an edited version
+	for (size_t j = 0; j < previous.size(); ++j)
 	{
-		generateLogFrequencies(_frequencies, canvasWidth);
-		updateResponse();
+		if (!reused[j])
+		{
+			changed = true;
+			removeContribution(previous[j]);
+		}
 	}
 
+	updateDbRange();
+	if (changed)
+		requestSecondaryTrace();
+	update();
+}
+
+void FrequencyResponseWidget::replaceContribution(FilterContribution& contribution, FilterBank newBank)
+{
+	if (newBank == contribution.bank)
+		return;
+
+	removeContribution(contribution);
+
+	contribution.bank = std::move(newBank);
+	contribution.db = calculateContribution(contribution.bank);
+	for (size_t i = 0, n = _response.size(); i < n; ++i)
+		_response[i] += contribution.db[i];
+}
+
+void FrequencyResponseWidget::removeContribution(FilterContribution& contribution)
+{
+	if (contribution.bank == FilterBank{})
+		return; // Disabled or unsupported filter, nothing to subtract
+
+	if (contribution.db.empty())
+		contribution.db = calculateContribution(contribution.bank);
+
+	for (size_t i = 0, n = _response.size(); i < n; ++i)
+		_response[i] -= contribution.db[i];
+}
+
+std::vector<double> FrequencyResponseWidget::calculateContribution(const FilterBank& bank) const
+{
+	std::vector<double> db(_grid.size());
+	calculateFrequencyResponse(bank, _grid, db.data());
+	return db;
+}
+
+void FrequencyResponseWidget::updateDbRange()
+{
+	// Calculate dynamic min and max dB values
+	const std::vector<double>& shown = _channelResponses.empty() ? _response : _channelResponses;
+	auto [minIt, maxIt] = std::minmax_element(shown.begin(), shown.end());
+	_minDb = std::max(std::floor(*minIt), MinDisplayDb);
+	_maxDb = std::ceil(*maxIt);
+}
+
+void FrequencyResponseWidget::paintEvent(QPaintEvent* /*event*/)
+{
+	const int canvasWidth = width() - MarginLeft - MarginRight;
+	if (canvasWidth != _requestedPoints)
+		requestResponse(canvasWidth);
+
+	const qreal dpr = devicePixelRatioF();
+	if (_gridLayer.isNull() || _gridLayerSize != size() || _gridLayer.devicePixelRatio() != dpr || _gridLayerMinDb != _minDb || _gridLayerMaxDb != _maxDb)
+		updateGridLayer();
+
+	QPainter painter(this);
+	painter.drawPixmap(0, 0, _gridLayer);
+
+	painter.setRenderHint(QPainter::Antialiasing);
+	drawResponse(painter); // The last finished curve, stretched to the current width if it's being recalculated
+}
+
+void FrequencyResponseWidget::updateGridLayer()
+{
+	const qreal dpr = devicePixelRatioF();
+	_gridLayer = QPixmap(size() * dpr);
+	_gridLayer.setDevicePixelRatio(dpr);
+	_gridLayer.fill(Qt::white);
+
+	QPainter painter(&_gridLayer);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setFont(font()); // A pixmap painter doesn't inherit the widget font
 	drawGrid(painter);
-	drawResponse(painter);
+
+	_gridLayerSize = size();
+	_gridLayerMinDb = _minDb;
+	_gridLayerMaxDb = _maxDb;
 }
 
 void FrequencyResponseWidget::drawGrid(QPainter& painter)
@@ -139,12 +461,12 @@ void FrequencyResponseWidget::drawGrid(QPainter& painter)
 
 	// Draw vertical grid lines (frequency)
 	const std::array freqMarkers{
-		(int)_frequencies.front(),
+		(int)MinFrequency,
 		20, 30, 40, 60, 80,
 		100, 200, 300, 400, 600, 800,
 		1000, 2000, 3000, 4000, 5000, 7000,
 		10000, 14000,
-		(int)_frequencies.back()
+		(int)MaxFrequency
 	};
 
 	for (size_t i = 0; i < freqMarkers.size(); ++i)
@@ -176,37 +498,85 @@ void FrequencyResponseWidget::drawResponse(QPainter& p)
 	if (_response.empty())
 		return;
 
-	const double graphWidth = static_cast<double>(width() - MarginLeft - MarginRight);
+	// The x coordinates only depend on the grid and the width, so they are only recalculated on resize
+	if (_curvePoints.size() != _response.size() || _curvePointsWidth != width())
+		updateCurveXCoordinates();
+
 	const double graphHeight = static_cast<double>(height() - MarginTop - MarginBottom);
 
-	// Draw the frequency response curve
-	p.setPen(QPen(QColor(0, 120, 215), 2));  // Blue curve
+	auto drawCurve = [&](const double* response, const QColor& color) {
+		p.setPen(QPen(color, 2));
+		for (size_t i = 0, n = _curvePoints.size(); i < n; ++i)
+		{
+			// Clamp to visible range
+			const double db = std::max(_minDb, std::min(_maxDb, response[i]));
+			_curvePoints[i].setY((double)MarginTop + dbToY(db, _minDb, _maxDb) * graphHeight);
+		}
 
-	std::vector<QPointF> points;
-	points.reserve(_frequencies.size());
+		p.drawPolyline(_curvePoints.data(), (int)_curvePoints.size());
+	};
 
-	for (size_t i = 0, n = _frequencies.size(); i < n; ++i)
+	const size_t channelCount = _channelResponses.size() / _response.size();
+	if (channelCount == 0)
 	{
-		const double freq = _frequencies[i];
-		double db = _response[i];
-
-		// Clamp to visible range
-		db = std::max(_minDb, std::min(_maxDb, db));
+		drawCurve(_response.data(), ChannelColors[0]);
+		drawSecondaryTrace(p);
+		return;
+	}
 
-		const double x = (double)MarginLeft + freqToX(freq) * graphWidth;
-		const double y = (double)MarginTop + dbToY(db, _minDb, _maxDb) * graphHeight;
+	// The legend is in the top right corner, one channel name per line
+	const QFontMetrics fm(p.font());
+	for (size_t c = 0; c < channelCount; ++c)
+	{
+		drawCurve(_channelResponses.data() + c * _response.size(), ChannelColors[c]);
 
-		points.emplace_back(x, y);
+		const QString name = ChannelNames[c].toString();
+		p.drawText(width() - MarginRight - 5 - fm.horizontalAdvance(name), MarginTop + fm.ascent() + 2 + static_cast<int>(c) * fm.height(), name);
 	}
+}
+
+void FrequencyResponseWidget::drawSecondaryTrace(QPainter& p)
+{
+	if (_secondary.size() != _curvePoints.size())
+		return;
+
+	const double graphHeight = static_cast<double>(height() - MarginTop - MarginBottom);
+	for (size_t i = 0, n = _curvePoints.size(); i < n; ++i)
+		_curvePoints[i].setY((double)MarginTop + dbToY(_secondary[i], _secondaryMin, _secondaryMax) * graphHeight);
+
+	p.setPen(QPen(SecondaryTraceColor, 1.5, Qt::DashLine));
+	p.drawPolyline(_curvePoints.data(), (int)_curvePoints.size());
+
+	// The axis only has its ends labelled, inside the right edge of the graph
+	const bool phase = _secondaryTrace == SecondaryTrace::Phase;
+	auto label = [phase](double value) { return phase ? QString("%1%2").arg(value, 0, 'f', 0).arg(QChar(0x00B0)) : QString("%1 ms").arg(value, 0, 'f', 1); };
+	const QString top = (phase ? "Phase " : "Group delay ") + label(_secondaryMax);
+	const QString bottom = label(_secondaryMin);
+
+	const QFontMetrics fm(p.font());
+	const int right = width() - MarginRight - 5;
+	p.setPen(SecondaryTraceColor);
+	p.drawText(right - fm.horizontalAdvance(top), MarginTop + fm.ascent() + 2, top);
+	p.drawText(right - fm.horizontalAdvance(bottom), height() - MarginBottom - fm.descent() - 2, bottom);
+}
+
+void FrequencyResponseWidget::updateCurveXCoordinates()
+{
+	const double graphWidth = static_cast<double>(width() - MarginLeft - MarginRight);
+	const auto& frequencies = _grid.frequencies();
+
+	_curvePoints.resize(frequencies.size());
+	for (size_t i = 0, n = frequencies.size(); i < n; ++i)
+		_curvePoints[i].setX((double)MarginLeft + freqToX(frequencies[i]) * graphWidth);
 
-	p.drawPolyline(points.data(), (int)points.size());
+	_curvePointsWidth = width();
 }
 
 double FrequencyResponseWidget::freqToX(double freq) const
 {
 	// Logarithmic scale
-	double logMin = std::log10(_frequencies.front());
-	double logMax = std::log10(_frequencies.back());
+	double logMin = std::log10(MinFrequency);
+	double logMax = std::log10(MaxFrequency);
 	double logFreq = std::log10(freq);
 	return (logFreq - logMin) / (logMax - logMin);
 }
@@ -1,30 +1,115 @@
 #pragma once
 
 #include "Filter.h"
+#include "FrequencyResponse.h"
 
+#include <QPixmap>
+#include <QPointF>
+#include <QThreadPool>
 #include <QWidget>
+
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 class FrequencyResponseWidget final : public QWidget {
 public:
+	enum class SecondaryTrace {
+		None,
+		Phase,
+		GroupDelay
+	};
+
 	explicit FrequencyResponseWidget(QWidget* parent = nullptr);
+	~FrequencyResponseWidget() override;
 
-	void setFilters(const std::vector<FilterUniquePtr>& filters);
+	void setFilters(const FilterList& filters);
+	// Recalculates the response of the whole filter chain in the background.
+	// The last finished curve keeps being painted until the new one arrives.
 	void updateResponse();
+	// Applies the changes of the filters' parameters to the cached response, independent of the total filter count
+	void updateFilters(const std::vector<size_t>& filterIndices);
+	// Applies added, removed or replaced filters to the cached response
+	void syncFilters();
+	// Draws one curve per channel of a channel-scoped chain instead of the curve of the filters, an empty list
+	// goes back to that curve. All the channels are evaluated together on the worker, so it costs about as much as
+	// a mono chain, and only when the list has changed.
+	void setChannelFilters(ChannelFilterList filters);
+	// Draws the phase or the group delay of the filters over the magnitude, against an axis of its own on the right.
+	// Not drawn with the channel curves.
+	void setSecondaryTrace(SecondaryTrace trace);
 
 protected:
 	void paintEvent(QPaintEvent* event) override;
 
 private:
+	// The grid and the axes are cached in a pixmap that is only redrawn on resize or dB range change
+	void updateGridLayer();
 	void drawGrid(QPainter& painter);
 	void drawResponse(QPainter& painter);
+	void updateCurveXCoordinates();
 	double freqToX(double freq) const;
 
+	struct FilterContribution {
+		FilterBank bank; // The parameters the contribution was calculated for
+		std::vector<double> db; // Calculated on the first edit, empty until then
+	};
+
+	// What the worker calculates for a new grid
+	struct Response {
+		uint64_t generation = 0;
+		// A secondary trace or channel request made after this one supersedes what comes with the response
+		uint64_t secondaryGeneration = 0;
+		uint64_t channelGeneration = 0;
+		FrequencyGrid grid;
+		std::vector<double> db;
+		std::vector<double> secondary;
+		std::vector<double> channelDb;
+		std::vector<FilterBank> banks;
+	};
+
+	// Any result with an older generation than the latest request is dropped
+	void requestResponse(int numPoints);
+	void onResponseReady(Response response);
+
+	void replaceContribution(FilterContribution& contribution, FilterBank newBank);
+	void removeContribution(FilterContribution& contribution);
+	[[nodiscard]] std::vector<double> calculateContribution(const FilterBank& bank) const;
+	void requestChannelResponses();
+	// Recalculates the secondary trace of the current filters on the worker, after an edit or a change of trace
+	void requestSecondaryTrace();
+	void setSecondary(std::vector<double> secondary);
+	void drawSecondaryTrace(QPainter& painter);
+	void updateDbRange();
+
 private:
-	std::vector<double> _frequencies;
-	std::vector<double> _response;
-	const std::vector<FilterUniquePtr>* _filters = nullptr;
+	FrequencyGrid _grid;
+	std::vector<double> _response; // Running sum of all the filter contributions
+	std::vector<FilterContribution> _contributions; // One per filter, in the same order
+	const FilterList* _filters = nullptr;
+
+	ChannelFilterList _channelFilters;
+	std::vector<double> _channelResponses; // Channel after channel, on _grid
+
+	SecondaryTrace _secondaryTrace = SecondaryTrace::None;
+	std::vector<double> _secondary; // Degrees or milliseconds, on _grid
+	double _secondaryMin = 0.0;
+	double _secondaryMax = 0.0;
 
 	double _minDb = -12.0;
 	double _maxDb = 12.0;
+
+	QPixmap _gridLayer;
+	QSize _gridLayerSize;
+	double _gridLayerMinDb = 0.0;
+	double _gridLayerMaxDb = 0.0;
+
+	std::vector<QPointF> _curvePoints;
+	int _curvePointsWidth = -1;
+
+	int _requestedPoints = -1;
+	std::atomic<uint64_t> _generation = 0;
+	std::atomic<uint64_t> _secondaryGeneration = 0;
+	std::atomic<uint64_t> _channelGeneration = 0;
+	QThreadPool _workerPool;
 };
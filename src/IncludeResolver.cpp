@@ -0,0 +1,173 @@
+#include "IncludeResolver.h"
+#include "ConfigDocument.h"
+#include "ProfileCache.h"
+#include "ProfileParser.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+
+IncludeResolver::Result IncludeResolver::resolve(const QString& rootPath, const QByteArray& rootContents)
+{
+	Result result;
+	QStringList includeStack;
+	const QString path = QDir::cleanPath(QFileInfo(rootPath).absoluteFilePath());
+	if (resolveFile(path, rootContents, includeStack, result))
+	{
+		result.filters = _nodes.value(path).flattened;
+		std::replace(result.filters.channels.begin(), result.filters.channels.end(), InheritedChannels, AllChannels);
+	}
+
+	_nodes.removeIf([&](QHash<QString, Node>::iterator it) { return !result.filePaths.contains(it.key()); });
+	return result;
+}
+
+std::optional<QByteArray> IncludeResolver::resolveFile(const QString& path, std::optional<QByteArray> contents, QStringList& includeStack, Result& result)
+{
+	const QString fileName = QFileInfo(path).fileName();
+	if (!contents)
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			_nodes.remove(path);
+			result.errors.push_back("Failed to open included file: " + path);
+			return std::nullopt;
+		}
+
+		contents = file.readAll();
+	}
+
+	const QByteArray hash = ProfileCache::contentHash(*contents);
+	auto it = _nodes.find(path);
+	if (it == _nodes.end() || it->hash != hash)
+		it = _nodes.insert(path, parse(path, hash, *contents));
+
+	// The node can't be referenced across the recursion, inserting into the hash may move it
+	QStringList includes;
+	for (const auto& item : it->items)
+	{
+		if (const QString* include = std::get_if<QString>(&item))
+			includes.push_back(*include);
+	}
+
+	// A file included several times is applied several times, but its errors are only reported once
+	if (!result.filePaths.contains(path))
+	{
+		result.filePaths.push_back(path);
+		for (const QString& error : it->errors)
+			result.errors.push_back(fileName + ": " + error);
+	}
+
+	QCryptographicHash subtreeHash(QCryptographicHash::Md5);
+	subtreeHash.addData(hash);
+
+	std::vector<bool> resolved(static_cast<size_t>(includes.size()), false);
+	includeStack.push_back(path);
+	for (qsizetype i = 0; i < includes.size(); ++i)
+	{
+		const QString& include = includes[i];
+		if (includeStack.contains(include, Qt::CaseInsensitive))
+		{
+			result.errors.push_back("Include cycle: " + includeStack.join(" -> ") + " -> " + include);
+			subtreeHash.addData("cycle");
+			continue;
+		}
+
+		const std::optional<QByteArray> includeHash = resolveFile(include, std::nullopt, includeStack, result);
+		subtreeHash.addData(includeHash.value_or("missing"));
+		resolved[static_cast<size_t>(i)] = includeHash.has_value();
+	}
+	includeStack.pop_back();
+
+	Node& node = _nodes[path];
+	const QByteArray subtree = subtreeHash.result();
+	if (node.subtreeHash == subtree)
+		return subtree; // Nothing has changed below this file
+
+	// The includes have just been resolved, so their flattened chains are up to date
+	node.flattened = {};
+	node.flattened.namedChannels = node.namedChannels;
+	ChannelMask channels = InheritedChannels;
+	size_t includeIndex = 0;
+	for (const auto& item : node.items)
+	{
+		if (const Filter* filter = std::get_if<Filter>(&item))
+			node.flattened.append(*filter, channels);
+		else if (const ChannelMask* selection = std::get_if<ChannelMask>(&item))
+			channels = *selection;
+		else if (resolved[includeIndex++])
+		{
+			// The included filters that inherit the selection take this file's one
+			const ChannelFilterList& included = _nodes[std::get<QString>(item)].flattened;
+			for (size_t i = 0; i < included.filters.size(); ++i)
+				node.flattened.append(included.filters[i], included.channels[i] == InheritedChannels ? channels : included.channels[i]);
+			node.flattened.namedChannels |= included.namedChannels;
+		}
+	}
+	node.subtreeHash = subtree;
+
+	return subtree;
+}
+
+IncludeResolver::Node IncludeResolver::parse(const QString& path, const QByteArray& hash, const QByteArray& contents)
+{
+	Node node;
+	node.hash = hash;
+
+	const QDir folder = QFileInfo(path).dir();
+	const ConfigDocument document(QString::fromUtf8(contents));
+	for (size_t line = 0; line < document.size(); ++line)
+	{
+		if (document.isDisabled(line))
+			continue;
+
+		switch (document.type(line))
+		{
+		case ConfigDocument::LineType::Preamp:
+		case ConfigDocument::LineType::Filter:
+		{
+			auto filter = ProfileParser::parseLine(document.text(line));
+			if (!filter)
+			{
+				node.errors.push_back(filter.error());
+				break;
+			}
+
+			if (!asIFilter(filter.value()).isEnabled())
+				break;
+
+			if (std::holds_alternative<UnsupportedFilter>(filter.value()))
+				node.errors.push_back("Unsupported filter left out of the response: " + document.text(line).trimmed().toString());
+
+			node.items.emplace_back(std::in_place_type<Filter>, std::move(filter.value()));
+			break;
+		}
+		case ConfigDocument::LineType::Channel:
+		{
+			auto channels = ProfileParser::parseChannelLine(document.text(line));
+			if (!channels)
+			{
+				node.errors.push_back(channels.error());
+				break;
+			}
+
+			node.items.emplace_back(std::in_place_type<ChannelMask>, *channels);
+			if (document.argument(line).compare(u"all", Qt::CaseInsensitive) != 0)
+				node.namedChannels |= *channels;
+			break;
+		}
+		case ConfigDocument::LineType::Include:
+			// Relative to the including file
+			node.items.emplace_back(std::in_place_type<QString>, QDir::cleanPath(folder.absoluteFilePath(document.argument(line).toString())));
+			break;
+		default:
+			break;
+		}
+	}
+
+	return node;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Filter.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+#include <variant>
+#include <vector>
+
+// Walks the Include graph from config.txt and flattens it into the effective filter chain, the enabled filters
+// in the order Equalizer APO applies them, each with the channels selected by the "Channel:" lines. A file starts
+// with the selection of the file including it and the selection is restored after an Include. Device, Stage and If
+// sections are not evaluated, every enabled filter counts.
+// Parsed files are memoized by path and content hash, and the flattened chain of every file by the hashes of
+// its whole subtree, so a change re-parses only the changed file and re-flattens only the files including it.
+// Not thread-safe, meant to be used from a single worker thread.
+class IncludeResolver final {
+public:
+	struct Result {
+		ChannelFilterList filters;
+		QStringList filePaths; // Every file reached, the root first
+		QStringList errors; // Files that couldn't be read, lines that couldn't be parsed and include cycles
+	};
+
+	// The root contents are passed in so that the unsaved state of config.txt is resolved, the includes are read from disk.
+	// The memoized files that are no longer reached are forgotten.
+	[[nodiscard]] Result resolve(const QString& rootPath, const QByteArray& rootContents);
+
+private:
+	// The selection of the including file, which isn't known when a file is flattened
+	static constexpr ChannelMask InheritedChannels = 0;
+
+	struct Node {
+		QByteArray hash; // Of the file contents
+		// The enabled filters, the paths of the enabled includes and the channel selections, in order
+		std::vector<std::variant<Filter, QString, ChannelMask>> items;
+		ChannelMask namedChannels = 0; // By this file's selections, not the included ones
+		QStringList errors;
+
+		QByteArray subtreeHash; // Of the file and everything it includes, empty until flattened
+		ChannelFilterList flattened; // InheritedChannels for the filters before the file's first selection
+	};
+
+	// Returns the subtree hash of the file, nullopt if it couldn't be read
+	std::optional<QByteArray> resolveFile(const QString& path, std::optional<QByteArray> contents, QStringList& includeStack, Result& result);
+	static Node parse(const QString& path, const QByteArray& hash, const QByteArray& contents);
+
+	QHash<QString, Node> _nodes; // Keyed by the cleaned absolute path
+};
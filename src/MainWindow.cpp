@@ -1,11 +1,14 @@
 #include "MainWindow.h"
+#include "FrequencyResponseWidget.h"
 #include "ProfileEditorWindow.h"
+#include "ProfileListModel.h"
+#include "ProfileListView.h"
 #include "version.h"
 
 #include <QAction>
-#include <QButtonGroup>
 #include <QCheckBox>
 #include <QDesktopServices>
+#include <QDir>
 #include <QDoubleSpinBox>
 #include <QFile>
 #include <QGroupBox>
@@ -19,11 +22,9 @@
 #include <QMessageBox>
 #include <QProcess>
 #include <QPushButton>
-#include <QRadioButton>
 #include <QScreen>
-#include <QScrollArea>
-#include <QScrollBar>
 #include <QShortcut>
+#include <QSignalBlocker>
 #include <QStringList>
 #include <QTimer>
 #include <QVBoxLayout>
@@ -66,24 +67,46 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	searchWidget->setVisible(false);
 	groupBoxLayout->addWidget(searchWidget);
 
-	scrollArea = new QScrollArea(profilesGroupBox);
-	scrollArea->setWidgetResizable(true);  // Automatically resizes viewport widget to fit contents
-	scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-	scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-	groupBoxLayout->addWidget(scrollArea);
-
-	QWidget* scrollContent = new QWidget(scrollArea);
-	scrollLayout = new QGridLayout(scrollContent);
-	scrollLayout->setColumnStretch(0, 1);
-	scrollLayout->setColumnStretch(1, 1);
-	scrollLayout->setAlignment(Qt::AlignTop);
-	scrollLayout->setContentsMargins(0, 0, 0, 0);
-	scrollArea->setWidget(scrollContent);
-
-	profileButtonGroup = new QButtonGroup(this);
-	profileButtonGroup->setExclusive(false); // Allow none selected
+	profileModel = new ProfileListModel(_thumbnails, [this] { applyChanges(); }, this);
+	profileView = new ProfileListView(_thumbnails.size(), profilesGroupBox);
+	profileView->setModel(profileModel);
+	groupBoxLayout->addWidget(profileView);
+
+	profileView->setContextMenuPolicy(Qt::CustomContextMenu);
+	connect(profileView, &QWidget::customContextMenuRequested, this, [this](QPoint pos) {
+		const QModelIndex index = profileView->indexAt(pos);
+		if (!index.isValid())
+			return;
+
+		const QString name = index.data(ProfileListModel::FileNameRole).toString();
+		QMenu contextMenu(this);
+
+		QAction* editProfileAction = contextMenu.addAction("Edit Profile...");
+		connect(editProfileAction, &QAction::triggered, [this, name]() {
+			const QString filePath = _config.configFolder() + "/" + name;
+			auto* editorWindow = new ProfileEditorWindow(filePath, this);
+			editorWindow->setAttribute(Qt::WA_DeleteOnClose);
+			editorWindow->setWindowModality(Qt::ApplicationModal);
+			editorWindow->resize(800, 600);
+			editorWindow->show();
+		});
+
+		QAction* openAction = contextMenu.addAction("Open in Notepad");
+		connect(openAction, &QAction::triggered, [this, name]() {
+			editFile(name);
+		});
+
+		contextMenu.exec(profileView->viewport()->mapToGlobal(pos));
+	});
+
 	mainLayout->addWidget(profilesGroupBox);
 
+	// config.txt together with everything it includes
+	systemResponse = new FrequencyResponseWidget(this);
+	systemResponse->setMinimumHeight(160);
+	systemResponse->setFilters(_effectiveFilters);
+	mainLayout->addWidget(systemResponse);
+
 	auto* buttonsLayout = new QHBoxLayout;
 	buttonsLayout->setSpacing(1);
 	QPushButton* newConfigButton = new QPushButton("Create new EQ", this);
@@ -108,12 +131,17 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	//mainLayout->addStretch();
 	setCentralWidget(centralWidget);
 
+	// One scan at a time, the scan itself is spread across all the cores
+	_scanPool.setMaxThreadCount(1);
+	_resolvePool.setMaxThreadCount(1);
+	_thumbnails.setSize(ProfileThumbnails::DefaultSize, devicePixelRatioF());
+	_saveScheduler.setFrameInterval(SaveIntervalMs);
+
 	loadConfig();
 
-	connect(profileButtonGroup, &QButtonGroup::buttonToggled, this, &MainWindow::applyChanges);
-	connect(preampCheck, &QCheckBox::toggled, this, &MainWindow::applyChanges);
+	connect(preampCheck, &QCheckBox::toggled, this, &MainWindow::applyPreampChanges);
 	connect(preampCheck, &QCheckBox::toggled, preampSpin, &QDoubleSpinBox::setEnabled);
-	connect(preampSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::applyChanges);
+	connect(preampSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::applyPreampChanges);
 
 	// Search functionality
 	connect(searchEdit, &QLineEdit::textChanged, this, &MainWindow::filterProfiles);
@@ -136,6 +164,17 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	resize(width(), windowHeight);
 }
 
+MainWindow::~MainWindow()
+{
+	_saveScheduler.flush();
+	_configIo.waitForDone();
+
+	_scanPool.clear();
+	_scanPool.waitForDone();
+	_resolvePool.clear();
+	_resolvePool.waitForDone();
+}
+
 void MainWindow::createNewConfig()
 {
 	QString fileName = QInputDialog::getText(this, "New Config File",
@@ -144,110 +183,122 @@ void MainWindow::createNewConfig()
 	if (fileName.isEmpty())
 		return;
 
-	const auto result = _config.createNewProfile(fileName);
-	if (!result.has_value())
-	{
-		QMessageBox::critical(this, "Error", result.error());
-		return;
-	}
+	fileName = EqApoConfig::profileFileName(fileName);
+	const QString filePath = _config.configFolder() + "/" + fileName;
+	_configIo.createProfile(filePath)
+		.then(this, [this, fileName, filePath](const std::expected<void, QString>& result) {
+			if (!result)
+			{
+				QMessageBox::critical(this, "Error", result.error());
+				return;
+			}
 
-	// Refresh UI to reflect the newly added profile
-	loadConfig();
-	editFile(result.value());
+			// Like the other edits, the include goes through the document along with the pending changes
+			if (_config.addProfileInclude(fileName))
+				saveConfig();
+
+			// Refresh UI to reflect the newly added profile
+			loadConfig();
+			editFile(filePath);
+		});
 }
 
 void MainWindow::applyChanges()
 {
-	assert(profileButtons.size() == _config.profiles().size());
+	assert(static_cast<size_t>(profileModel->rowCount()) == _config.profiles().size());
+
+	for (size_t i = 0; i < _config.profiles().size(); ++i)
+		_config.setProfileEnabled(i, profileModel->isChecked(static_cast<int>(i)));
 
+	_saveScheduler.schedule();
+	resolveIncludes();
+}
+
+void MainWindow::applyPreampChanges()
+{
 	_config.setPreampGain(preampSpin->value(), preampCheck->isChecked());
-	for (size_t i = 0; i < profileButtons.size(); ++i)
-	{
-		auto* btn = profileButtons[i];
-		_config.setProfileEnabled(i, btn->isChecked());
-	}
 
-	if (const auto result = _config.saveState(); !result)
-		QMessageBox::critical(this, "Error", result.error());
+	_saveScheduler.schedule();
+	resolveIncludes();
+}
+
+void MainWindow::saveConfig()
+{
+	const std::optional<QByteArray> contents = _config.takeStateToSave();
+	if (!contents)
+		return;
+
+	++_configWriteCount;
+	_fileWatcher.noteOwnWrite(_config.configFilePath(), *contents);
+	_configIo.replaceFile(_config.configFilePath(), *contents).then(this, [this](const std::expected<void, QString>& result) {
+		if (!result)
+		{
+			_config.onSaveFailed();
+			QMessageBox::critical(this, "Error", result.error());
+		}
+	});
 }
 
 void MainWindow::loadConfig()
 {
-	for (auto* btn : profileButtons)
-	{
-		profileButtonGroup->removeButton(btn);
-		scrollLayout->removeWidget(btn);
-		btn->deleteLater();
-	}
+	// The pending changes are submitted first, so that they are read back
+	_saveScheduler.flush();
+
+	const uint64_t writeCount = _configWriteCount;
+	_configIo.readFile(_config.configFilePath()).then(this, [this, writeCount](const std::expected<QByteArray, QString>& contents) {
+		// Changes made while reading would be reverted by the stale contents, read again after they have been written
+		if (writeCount != _configWriteCount)
+		{
+			loadConfig();
+			return;
+		}
+
+		applyConfig(contents ? _config.reloadConfig(contents.value()) : std::unexpected(contents.error()));
+	});
+}
 
-	profileButtons.clear();
-	const auto result = _config.reloadConfig();
-	if (!result)
-		QMessageBox::critical(this, "Error", result.error());
+void MainWindow::applyConfig(const std::expected<ConfigDiff, QString>& diff)
+{
+	const bool initialLoad = profileModel->rowCount() == 0;
 
-	QWidget* lastCheckedButton = nullptr;
+	if (diff)
+	{
+		// Only the changed rows are touched, so the scroll position and the hover state survive the reload
+		profileModel->applyDiff(_config.profiles(), diff.value());
+		if (!searchEdit->text().isEmpty() && (diff->addedCount > 0 || diff->removedCount > 0))
+			filterProfiles(searchEdit->text());
+	}
+	else
+	{
+		QMessageBox::critical(this, "Error", diff.error());
+		profileModel->setProfiles(_config.profiles());
+		filterProfiles(searchEdit->text());
+	}
 
-	for (const auto& profile: _config.profiles())
+	if (!diff || diff->preampChanged)
 	{
-		QString name = profile.name;
-		if (name.endsWith(".txt", Qt::CaseInsensitive))
-			name.chop(4);
-		QRadioButton* profileRadio = new QRadioButton(name, this);
-		connect(profileRadio, &QRadioButton::toggled, [this, profileRadio](bool checked) {
-			QFont f = profileRadio->font();
-			f.setBold(checked);
-			profileRadio->setFont(f);
-
-			if (!checked)
-				return;
-			for (auto* button : profileButtons)
-			{
-				if (button != profileRadio)
-					button->setChecked(false);
-			}
-		});
+		// Showing the loaded state isn't an edit, it must not be written back
+		const QSignalBlocker spinBlocker(preampSpin);
+		const QSignalBlocker checkBlocker(preampCheck);
+		const auto preamp = _config.preamp();
+		preampSpin->setValue(preamp.gain);
+		preampSpin->setEnabled(preamp.enabled);
+		preampCheck->setChecked(preamp.enabled);
+	}
 
-		if (profile.enabled)
-		{
-			profileRadio->setChecked(true);
-			lastCheckedButton = profileRadio;
-		}
-		profileButtonGroup->addButton(profileRadio);
-		profileButtons.push_back(profileRadio);
-		scrollLayout->addWidget(profileRadio);
-
-		profileRadio->setContextMenuPolicy(Qt::CustomContextMenu);
-		connect(profileRadio, &QWidget::customContextMenuRequested, this, [this, profileRadio, name{ profile.name }](QPoint pos) {
-			QMenu contextMenu(this);
-			
-			QAction* editProfileAction = contextMenu.addAction("Edit Profile...");
-			connect(editProfileAction, &QAction::triggered, [this, name]() {
-				const QString filePath = _config.configFolder() + "/" + name;
-				auto* editorWindow = new ProfileEditorWindow(filePath, this);
-				editorWindow->setAttribute(Qt::WA_DeleteOnClose);
-				editorWindow->setWindowModality(Qt::ApplicationModal);
-				editorWindow->resize(800, 600);
-				editorWindow->show();
-			});
-			
-			QAction* openAction = contextMenu.addAction("Open in Notepad");
-			connect(openAction, &QAction::triggered, [this, name]() {
-				editFile(name);
-			});
-			
-			contextMenu.exec(profileRadio->mapToGlobal(pos));
+	if (initialLoad)
+	{
+		QTimer::singleShot(0, this, [this] {
+			if (const int row = profileModel->firstCheckedRow(); row >= 0)
+				profileView->scrollTo(profileModel->index(row));
 		});
 	}
 
-	const auto preamp = _config.preamp();
-	preampSpin->setValue(preamp.gain);
-	preampSpin->setEnabled(preamp.enabled);
-	preampCheck->setChecked(preamp.enabled);
+	updateWatchedFiles();
 
-	QTimer::singleShot(0, this, [this, lastCheckedButton] {
-		if (lastCheckedButton)
-			scrollArea->ensureWidgetVisible(lastCheckedButton);
-	});
+	// The profiles themselves may have changed even if config.txt hasn't, unchanged ones are served from the cache
+	scanProfiles();
+	resolveIncludes();
 }
 
 void MainWindow::editConfigTxt()
@@ -265,22 +316,24 @@ void MainWindow::editFile(QString fileName)
 
 void MainWindow::filterProfiles(const QString& searchText)
 {
+	const int profileCount = profileModel->rowCount();
 	if (searchText.isEmpty())
 	{
 		// Show all profiles
-		for (auto* btn : profileButtons)
-			btn->setVisible(true);
+		for (int row = 0; row < profileCount; ++row)
+			profileView->setRowHidden(row, false);
 		searchResultLabel->clear();
 		return;
 	}
 
 	const QString lowerSearch = searchText.toLower().remove(' ');
-	size_t visibleCount = 0;
+	int visibleCount = 0;
 
-	for (auto* btn : profileButtons)
+	for (int row = 0; row < profileCount; ++row)
 	{
-		const bool matches = btn->text().toLower().remove(' ').contains(lowerSearch);
-		btn->setVisible(matches);
+		const QString name = profileModel->index(row).data(Qt::DisplayRole).toString();
+		const bool matches = name.toLower().remove(' ').contains(lowerSearch);
+		profileView->setRowHidden(row, !matches);
 		if (matches)
 			++visibleCount;
 	}
@@ -288,10 +341,10 @@ void MainWindow::filterProfiles(const QString& searchText)
 	// Update result label
 	if (visibleCount == 0)
 		searchResultLabel->setText("No matches");
-	else if (visibleCount == profileButtons.size())
+	else if (visibleCount == profileCount)
 		searchResultLabel->setText(QString("All %1 profiles").arg(visibleCount));
 	else
-		searchResultLabel->setText(QString("%1 of %2").arg(visibleCount).arg(profileButtons.size()));
+		searchResultLabel->setText(QString("%1 of %2").arg(visibleCount).arg(profileCount));
 }
 
 void MainWindow::focusSearch()
@@ -300,3 +353,89 @@ void MainWindow::focusSearch()
 	searchEdit->setFocus();
 	searchEdit->selectAll();
 }
+
+void MainWindow::scanProfiles()
+{
+	QStringList fileNames;
+	for (const auto& profile : _config.profiles())
+		fileNames.push_back(profile.name);
+
+	const uint64_t generation = ++_scanGeneration;
+	_scanPool.start([this, generation, folder{ _config.configFolder() }, fileNames{ std::move(fileNames) }] {
+		ProfileIndex index = ProfileScanner::scan(folder, fileNames, &_profileCache);
+		// A cache that fails to save only means parsing the changed profiles again on the next scan
+		if (_profileCache.isModified())
+			(void)_profileCache.save();
+
+		QMetaObject::invokeMethod(this, [this, generation, index{ std::move(index) }]() mutable {
+			if (generation != _scanGeneration)
+				return;
+
+			profileModel->setIndex(std::move(index));
+		}, Qt::QueuedConnection);
+	});
+}
+
+void MainWindow::onFilesChanged(const QStringList& filePaths)
+{
+	// Reloading also rescans the profiles
+	if (filePaths.contains(_config.configFilePath()))
+	{
+		loadConfig();
+		return;
+	}
+
+	scanProfiles();
+	resolveIncludes();
+}
+
+void MainWindow::updateWatchedFiles()
+{
+	const QDir folder(_config.configFolder());
+	QStringList filePaths{ _config.configFilePath() };
+	for (const auto& profile : _config.profiles())
+		filePaths.push_back(folder.filePath(profile.name));
+
+	filePaths += _includedFiles;
+	filePaths.removeDuplicates();
+	_fileWatcher.setFiles(filePaths);
+}
+
+void MainWindow::resolveIncludes()
+{
+	const uint64_t generation = ++_resolveGeneration;
+	_resolvePool.clear(); // Only the latest state matters
+	_resolvePool.start([this, generation, filePath{ _config.configFilePath() }, contents{ _config.serializeState() }] {
+		IncludeResolver::Result result = _includeResolver.resolve(filePath, contents);
+
+		QMetaObject::invokeMethod(this, [this, generation, result{ std::move(result) }]() mutable {
+			if (generation == _resolveGeneration)
+				applyResolution(std::move(result));
+		}, Qt::QueuedConnection);
+	});
+}
+
+void MainWindow::applyResolution(IncludeResolver::Result result)
+{
+	// Only the filters that differ from the previous chain are recalculated. A channel-scoped chain is drawn
+	// per channel instead, there's no single curve for it.
+	if (result.filters.channelCount() == 0)
+	{
+		_effectiveFilters = std::move(result.filters.filters);
+		result.filters = {};
+	}
+	else
+		_effectiveFilters.clear();
+	systemResponse->syncFilters();
+	systemResponse->setChannelFilters(std::move(result.filters));
+	systemResponse->setToolTip(result.errors.join('\n'));
+
+	// The profiles included by other profiles are watched as well
+	if (!result.filePaths.isEmpty())
+		result.filePaths.removeFirst(); // config.txt
+	if (result.filePaths != _includedFiles)
+	{
+		_includedFiles = std::move(result.filePaths);
+		updateWatchedFiles();
+	}
+}
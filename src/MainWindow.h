@@ -1,43 +1,80 @@
 #pragma once
+#include "ConfigFileService.h"
 #include "EqApoConfig.h"
+#include "FileChangeWatcher.h"
+#include "IncludeResolver.h"
+#include "ProfileCache.h"
+#include "ProfileThumbnails.h"
+#include "UpdateScheduler.h"
 
 #include <QMainWindow>
+#include <QThreadPool>
 
-#include <vector>
-
-class QButtonGroup;
+class FrequencyResponseWidget;
+class ProfileListModel;
+class ProfileListView;
 class QCheckBox;
 class QDoubleSpinBox;
-class QGridLayout;
 class QLabel;
 class QLineEdit;
-class QRadioButton;
-class QScrollArea;
 class QWidget;
 
 class MainWindow final : public QMainWindow {
 public:
 	MainWindow(QWidget* parent = nullptr);
+	~MainWindow() override;
 
 private:
 	void createNewConfig();
+	// Update the config state from the profile list or the preamp widgets and schedule saving it.
+	// Separate, so that toggling a profile doesn't write back a preamp rounded by the spinbox.
 	void applyChanges();
+	void applyPreampChanges();
+	void saveConfig();
+	// Reads config.txt in the background and then applies it
 	void loadConfig();
+	void applyConfig(const std::expected<ConfigDiff, QString>& diff);
 	void editConfigTxt();
 	void editFile(QString fileName);
 	void filterProfiles(const QString& searchText);
 	void focusSearch();
 
+	// Summarizes the profiles in the background and shows the summaries as the profile tooltips
+	void scanProfiles();
+	// config.txt or profiles changed by other programs
+	void onFilesChanged(const QStringList& filePaths);
+	void updateWatchedFiles();
+	// Resolves the includes of the current config.txt state in the background and shows the response of the whole chain
+	void resolveIncludes();
+	void applyResolution(IncludeResolver::Result result);
+
 private:
 	EqApoConfig _config;
-	std::vector<QRadioButton*> profileButtons;
+	FileChangeWatcher _fileWatcher{ [this](const QStringList& filePaths) { onFilesChanged(filePaths); } };
+
+	// Every write makes Equalizer APO rebuild its filters, dragging the preamp writes at most this often
+	static constexpr int SaveIntervalMs = 250;
+	UpdateScheduler _saveScheduler{ [this] { saveConfig(); } };
+	uint64_t _configWriteCount = 0;
+	ConfigFileService _configIo;
+
+	ProfileCache _profileCache{ ProfileCache::defaultFilePath() }; // Only used by the scans
+	uint64_t _scanGeneration = 0; // Discards the results of the scans made obsolete by a reload
+	QThreadPool _scanPool;
+	IncludeResolver _includeResolver; // Only used from the resolve pool
+	uint64_t _resolveGeneration = 0;
+	QThreadPool _resolvePool;
+	FilterList _effectiveFilters; // Shown by systemResponse
+	QStringList _includedFiles; // Reached through the includes, watched as well
+
+	ProfileThumbnails _thumbnails{ [this](const QByteArray& hash) { profileModel->onThumbnailReady(hash); } };
 
 	QCheckBox* preampCheck = nullptr;
 	QDoubleSpinBox* preampSpin = nullptr;
 
-	QButtonGroup* profileButtonGroup = nullptr;
-	QGridLayout* scrollLayout = nullptr;
-	QScrollArea* scrollArea = nullptr;
+	ProfileListModel* profileModel = nullptr;
+	ProfileListView* profileView = nullptr;
+	FrequencyResponseWidget* systemResponse = nullptr;
 
 	QWidget* searchWidget = nullptr;
 	QLineEdit* searchEdit = nullptr;
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Calls function(i) for every i in [0, count) using all the available cores, the calling thread included.
+// Returns when all the calls have finished. The calls are not ordered in any way.
+template <typename Function>
+void parallelFor(size_t count, Function&& function)
+{
+	const size_t threadCount = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+	std::atomic<size_t> next = 0;
+	auto worker = [&] {
+		for (size_t i = next++; i < count; i = next++)
+			function(i);
+	};
+
+	std::vector<std::jthread> threads;
+	threads.reserve(threadCount);
+	for (size_t t = 1; t < threadCount; ++t)
+		threads.emplace_back(worker);
+
+	worker();
+} // The threads are joined here
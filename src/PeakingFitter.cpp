@@ -0,0 +1,458 @@
+#include "PeakingFitter.h"
+#include "ParallelFor.h"
+
+#include <QFile>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+namespace {
+
+// 10 * log10(x) == DbPerNeper * ln(x)
+inline constexpr double DbPerNeper = 10.0 / std::numbers::ln10;
+inline constexpr size_t ParametersPerFilter = 3; // ln(fc), gain, ln(Q)
+
+// A peaking biquad and the derivatives of its coefficients with respect to ln(fc), the gain and ln(Q)
+struct PeakingSection {
+	BiquadCoefficients coef;
+	std::array<BiquadCoefficients, ParametersPerFilter> derivatives;
+};
+
+PeakingSection makeSection(const double* parameters, double sampleRate)
+{
+	const double fc = std::exp(parameters[0]);
+	const double gainDb = parameters[1];
+	const double q = std::exp(parameters[2]);
+
+	const double A = std::pow(10.0, gainDb / 40.0);
+	const double omega = 2.0 * M_PI * fc / sampleRate;
+	const double sn = std::sin(omega);
+	const double cs = std::cos(omega);
+	const double alpha = sn / (2.0 * q);
+
+	PeakingSection section;
+	section.coef = calculatePeakingCoefficients(fc, gainDb, q, sampleRate);
+
+	// Through omega, d omega / d ln(fc) = omega, which moves both alpha and the cosine
+	const double dAlpha = cs / (2.0 * q) * omega;
+	const double dCos = 2.0 * sn * omega;
+	section.derivatives[0] = { A * dAlpha, dCos, -A * dAlpha, dAlpha / A, dCos, -dAlpha / A };
+
+	// Through A = 10^(gain / 40)
+	const double dA = A * std::numbers::ln10 / 40.0;
+	section.derivatives[1] = { alpha * dA, 0.0, -alpha * dA, -alpha / (A * A) * dA, 0.0, alpha / (A * A) * dA };
+
+	// Through alpha, d alpha / d ln(Q) = -alpha
+	section.derivatives[2] = { -alpha * A, 0.0, alpha * A, -alpha / A, 0.0, alpha / A };
+
+	return section;
+}
+
+// The least squares problem: the parameters of every filter followed by the constant offset
+class Problem {
+public:
+	Problem(const FrequencyGrid& grid, const std::vector<double>& target, const PeakingFitter::Options& options) :
+		_grid(grid),
+		_target(target),
+		_options(options)
+	{
+	}
+
+	[[nodiscard]] size_t filterCount() const { return _options.filterCount; }
+	[[nodiscard]] size_t parameterCount() const { return ParametersPerFilter * _options.filterCount + 1; }
+
+	// The sum of the squared residuals. The normal equations J^T J and J^T r are filled if requested.
+	double evaluate(const std::vector<double>& x, std::vector<double>* jtj = nullptr, std::vector<double>* jtr = nullptr) const
+	{
+		const size_t filters = filterCount();
+		const size_t n = parameterCount();
+
+		std::vector<PeakingSection> sections(filters);
+		for (size_t k = 0; k < filters; ++k)
+			sections[k] = makeSection(&x[ParametersPerFilter * k], _grid.sampleRate());
+
+		if (jtj)
+		{
+			jtj->assign(n * n, 0.0);
+			jtr->assign(n, 0.0);
+		}
+
+		std::vector<double> row(n);
+		row[n - 1] = 1.0; // The offset
+		double cost = 0.0;
+		for (size_t i = 0, count = _grid.size(); i < count; ++i)
+		{
+			const double c1 = _grid.cos1()[i], s1 = _grid.sin1()[i], c2 = _grid.cos2()[i], s2 = _grid.sin2()[i];
+
+			// The product of the power ratios is converted to dB once per point, like in the response kernels
+			double product = 1.0;
+			for (size_t k = 0; k < filters; ++k)
+			{
+				const BiquadCoefficients& coef = sections[k].coef;
+				const double numReal = coef.b0 + coef.b1 * c1 + coef.b2 * c2;
+				const double numImag = coef.b1 * s1 + coef.b2 * s2;
+				const double denReal = coef.a0 + coef.a1 * c1 + coef.a2 * c2;
+				const double denImag = coef.a1 * s1 + coef.a2 * s2;
+				const double num = numReal * numReal + numImag * numImag;
+				const double den = denReal * denReal + denImag * denImag;
+				product *= num / den;
+
+				if (!jtj)
+					continue;
+
+				// d(10 log10(N / D)) = DbPerNeper * (dN / N - dD / D), with dN = 2 Re(conj(B) dB) and the same for D
+				const double invNum = 2.0 / num;
+				const double invDen = 2.0 / den;
+				for (size_t p = 0; p < ParametersPerFilter; ++p)
+				{
+					const BiquadCoefficients& d = sections[k].derivatives[p];
+					const double dNum = numReal * (d.b0 + d.b1 * c1 + d.b2 * c2) + numImag * (d.b1 * s1 + d.b2 * s2);
+					const double dDen = denReal * (d.a0 + d.a1 * c1 + d.a2 * c2) + denImag * (d.a1 * s1 + d.a2 * s2);
+					row[ParametersPerFilter * k + p] = DbPerNeper * (dNum * invNum - dDen * invDen);
+				}
+			}
+
+			const double residual = 10.0 * std::log10(product) + x[n - 1] - _target[i];
+			cost += residual * residual;
+
+			if (!jtj)
+				continue;
+
+			// Upper triangle only, mirrored below
+			for (size_t a = 0; a < n; ++a)
+			{
+				double* jtjRow = jtj->data() + a * n;
+				const double ja = row[a];
+				for (size_t b = a; b < n; ++b)
+					jtjRow[b] += ja * row[b];
+				(*jtr)[a] += ja * residual;
+			}
+		}
+
+		if (jtj)
+		{
+			for (size_t a = 0; a < n; ++a)
+			{
+				for (size_t b = 0; b < a; ++b)
+					(*jtj)[a * n + b] = (*jtj)[b * n + a];
+			}
+		}
+
+		return cost;
+	}
+
+	void clamp(std::vector<double>& x) const
+	{
+		for (size_t k = 0; k < filterCount(); ++k)
+		{
+			double* p = &x[ParametersPerFilter * k];
+			p[0] = std::clamp(p[0], std::log(_options.minFc), std::log(_options.maxFc));
+			p[1] = std::clamp(p[1], -_options.maxGainDb, _options.maxGainDb);
+			p[2] = std::clamp(p[2], std::log(_options.minQ), std::log(_options.maxQ));
+		}
+	}
+
+	// Places the filters one by one where the remaining error is the largest
+	[[nodiscard]] std::vector<double> greedyStart() const
+	{
+		std::vector<double> x(parameterCount(), 0.0);
+		x.back() = mean(_target);
+
+		std::vector<double> error(_target.size());
+		std::transform(_target.begin(), _target.end(), error.begin(), [&](double db) { return db - x.back(); });
+		for (size_t k = 0; k < filterCount(); ++k)
+		{
+			const auto worst = std::max_element(error.begin(), error.end(), [](double a, double b) { return std::abs(a) < std::abs(b); });
+			const size_t i = static_cast<size_t>(worst - error.begin());
+
+			double* p = &x[ParametersPerFilter * k];
+			p[0] = std::log(_grid.frequencies()[i]);
+			p[1] = *worst;
+			p[2] = 0.0; // Q = 1
+			clamp(x);
+
+			const std::vector<double> placed = calculateFrequencyResponse(
+				FilterList{ PeakingFilter{ std::exp(p[0]), p[1], std::exp(p[2]) } }, _grid);
+			for (size_t j = 0; j < error.size(); ++j)
+				error[j] -= placed[j];
+		}
+
+		return x;
+	}
+
+	// Spreads the filters evenly over the grid, each with the error at its frequency
+	[[nodiscard]] std::vector<double> evenStart() const
+	{
+		std::vector<double> x(parameterCount(), 0.0);
+		x.back() = mean(_target);
+
+		const size_t count = _grid.size();
+		for (size_t k = 0; k < filterCount(); ++k)
+		{
+			const size_t i = (2 * k + 1) * count / (2 * filterCount());
+			double* p = &x[ParametersPerFilter * k];
+			p[0] = std::log(_grid.frequencies()[i]);
+			p[1] = _target[i] - x.back();
+			p[2] = std::log(std::sqrt(2.0));
+		}
+
+		clamp(x);
+		return x;
+	}
+
+	[[nodiscard]] std::vector<double> perturbed(std::vector<double> x, unsigned seed) const
+	{
+		std::mt19937 random(seed);
+		std::normal_distribution<double> octaves(0.0, 0.5);
+		std::uniform_real_distribution<double> gainScale(0.5, 1.5);
+		std::normal_distribution<double> logQ(0.0, 0.5);
+		for (size_t k = 0; k < filterCount(); ++k)
+		{
+			double* p = &x[ParametersPerFilter * k];
+			p[0] += octaves(random) * std::numbers::ln2;
+			p[1] *= gainScale(random);
+			p[2] += logQ(random);
+		}
+
+		clamp(x);
+		return x;
+	}
+
+	// The offset that minimizes the error of the filters as they are
+	void fitOffset(std::vector<double>& x) const
+	{
+		const std::vector<double> response = filterResponse(x);
+		double sum = 0.0;
+		for (size_t i = 0; i < response.size(); ++i)
+			sum += _target[i] - response[i];
+		x.back() = sum / static_cast<double>(response.size());
+	}
+
+	[[nodiscard]] std::vector<double> filterResponse(const std::vector<double>& x) const
+	{
+		FilterBank bank;
+		for (size_t k = 0; k < filterCount(); ++k)
+			bank.addBiquad(makeSection(&x[ParametersPerFilter * k], _grid.sampleRate()).coef);
+
+		std::vector<double> response(_grid.size());
+		calculateFrequencyResponse(bank, _grid, response.data());
+		return response;
+	}
+
+private:
+	static double mean(const std::vector<double>& values)
+	{
+		double sum = 0.0;
+		for (const double value : values)
+			sum += value;
+		return sum / static_cast<double>(values.size());
+	}
+
+	const FrequencyGrid& _grid;
+	const std::vector<double>& _target;
+	const PeakingFitter::Options& _options;
+};
+
+// Solves (J^T J + lambda diag(J^T J)) step = -J^T r by Cholesky, false if the matrix isn't positive definite
+bool solveDamped(const std::vector<double>& jtj, const std::vector<double>& jtr, double lambda, std::vector<double>& step)
+{
+	const size_t n = jtr.size();
+	std::vector<double> l(jtj);
+	for (size_t a = 0; a < n; ++a)
+		l[a * n + a] += lambda * std::max(jtj[a * n + a], 1e-12);
+
+	// In place, the lower triangle becomes L
+	for (size_t j = 0; j < n; ++j)
+	{
+		double diagonal = l[j * n + j];
+		for (size_t k = 0; k < j; ++k)
+			diagonal -= l[j * n + k] * l[j * n + k];
+		if (!(diagonal > 0.0))
+			return false;
+
+		diagonal = std::sqrt(diagonal);
+		l[j * n + j] = diagonal;
+		for (size_t i = j + 1; i < n; ++i)
+		{
+			double value = l[i * n + j];
+			for (size_t k = 0; k < j; ++k)
+				value -= l[i * n + k] * l[j * n + k];
+			l[i * n + j] = value / diagonal;
+		}
+	}
+
+	// L y = -J^T r, then L^T step = y
+	step.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		double value = -jtr[i];
+		for (size_t k = 0; k < i; ++k)
+			value -= l[i * n + k] * step[k];
+		step[i] = value / l[i * n + i];
+	}
+	for (size_t i = n; i-- > 0;)
+	{
+		double value = step[i];
+		for (size_t k = i + 1; k < n; ++k)
+			value -= l[k * n + i] * step[k];
+		step[i] = value / l[i * n + i];
+	}
+
+	return true;
+}
+
+struct Solution {
+	std::vector<double> x;
+	double cost = 0.0;
+	int iterations = 0;
+};
+
+Solution levenbergMarquardt(const Problem& problem, std::vector<double> x, int maxIterations)
+{
+	std::vector<double> jtj, jtr, step;
+	double cost = problem.evaluate(x, &jtj, &jtr);
+	double lambda = 1e-3;
+
+	int iteration = 0;
+	while (iteration < maxIterations)
+	{
+		++iteration;
+		if (!solveDamped(jtj, jtr, lambda, step))
+		{
+			lambda *= 10.0;
+			continue;
+		}
+
+		std::vector<double> trial(x);
+		for (size_t i = 0; i < trial.size(); ++i)
+			trial[i] += step[i];
+		problem.clamp(trial);
+
+		// The normal equations are only needed at the accepted points
+		const double trialCost = problem.evaluate(trial);
+		if (trialCost < cost)
+		{
+			const double improvement = cost - trialCost;
+			x = std::move(trial);
+			cost = problem.evaluate(x, &jtj, &jtr);
+			lambda = std::max(lambda / 3.0, 1e-12);
+
+			if (improvement < 1e-6 * cost)
+				break; // Converged, the remaining improvements are far below what can be heard
+		}
+		else
+		{
+			lambda *= 2.0;
+			if (lambda > 1e12)
+				break; // No step makes it better
+		}
+	}
+
+	return { std::move(x), cost, iteration };
+}
+
+} // namespace
+
+std::expected<PeakingFitter::Result, QString> PeakingFitter::fit(const FrequencyGrid& grid, const std::vector<double>& targetDb, const Options& options)
+{
+	if (targetDb.size() != grid.size())
+		return std::unexpected(QString("The target has %1 points for a grid of %2").arg(targetDb.size()).arg(grid.size()));
+
+	const Problem problem(grid, targetDb, options);
+	if (options.filterCount == 0 || options.startCount == 0 || grid.size() < problem.parameterCount())
+		return std::unexpected(QString("Can't fit %1 filters to %2 points").arg(options.filterCount).arg(grid.size()));
+
+	// The starts are independent, each one runs on a core of its own
+	const std::vector<double> greedy = problem.greedyStart();
+	std::vector<Solution> solutions(options.startCount);
+	parallelFor(options.startCount, [&](size_t start) {
+		const std::vector<double> x = start == 0 ? greedy : start == 1 ? problem.evenStart() : problem.perturbed(greedy, static_cast<unsigned>(start));
+		solutions[start] = levenbergMarquardt(problem, x, options.maxIterations);
+	});
+
+	Solution best = std::move(*std::min_element(solutions.begin(), solutions.end(),
+		[](const Solution& a, const Solution& b) { return a.cost < b.cost; }));
+
+	// Rounded the way they would be typed in, the error is the one of the rounded filters
+	std::vector<double>& x = best.x;
+	for (size_t k = 0; k < problem.filterCount(); ++k)
+	{
+		double* p = &x[ParametersPerFilter * k];
+		p[0] = std::log(std::round(std::exp(p[0])));
+		p[1] = std::round(p[1] * 10.0) / 10.0;
+		p[2] = std::log(std::round(std::exp(p[2]) * 100.0) / 100.0);
+	}
+	problem.clamp(x);
+	problem.fitOffset(x);
+
+	const std::vector<double> response = problem.filterResponse(x);
+	const double peak = std::max(0.0, *std::max_element(response.begin(), response.end()));
+
+	Result result;
+	result.rmsErrorDb = std::sqrt(problem.evaluate(x) / static_cast<double>(grid.size()));
+	result.iterations = best.iterations;
+	result.filters.push_back(PreampFilter{ -std::ceil(peak * 10.0) / 10.0 });
+
+	FilterList peaking;
+	for (size_t k = 0; k < problem.filterCount(); ++k)
+	{
+		const double* p = &x[ParametersPerFilter * k];
+		peaking.push_back(PeakingFilter{ std::round(std::exp(p[0])), p[1], std::round(std::exp(p[2]) * 100.0) / 100.0 });
+	}
+	std::sort(peaking.begin(), peaking.end(), [](const Filter& a, const Filter& b) {
+		return std::get<PeakingFilter>(a).fc() < std::get<PeakingFilter>(b).fc();
+	});
+	result.filters.insert(result.filters.end(), peaking.begin(), peaking.end());
+
+	return result;
+}
+
+std::expected<PeakingFitter::Curve, QString> PeakingFitter::readCurve(const QString& filePath, size_t pointCount)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return std::unexpected("Failed to open file for reading: " + filePath);
+
+	std::vector<double> frequencies, levels;
+	static const QRegularExpression separators("[\\s,;]+");
+	while (!file.atEnd())
+	{
+		const QString line = QString::fromUtf8(file.readLine()).trimmed();
+		const QStringList fields = line.split(separators, Qt::SkipEmptyParts);
+		if (fields.size() < 2)
+			continue;
+
+		bool frequencyOk = false, levelOk = false;
+		const double frequency = fields[0].toDouble(&frequencyOk);
+		const double level = fields[1].toDouble(&levelOk);
+		if (!frequencyOk || !levelOk || frequency <= 0.0 || (!frequencies.empty() && frequency <= frequencies.back()))
+			continue; // Headers, comments and anything out of order
+
+		frequencies.push_back(frequency);
+		levels.push_back(level);
+	}
+
+	const double minFrequency = std::max(frequencies.empty() ? 0.0 : frequencies.front(), 20.0);
+	const double maxFrequency = std::min(frequencies.empty() ? 0.0 : frequencies.back(), 20000.0);
+	if (frequencies.size() < 2 || minFrequency >= maxFrequency || pointCount < 2)
+		return std::unexpected("No curve between 20 Hz and 20 kHz in: " + filePath);
+
+	// Linear in dB over the log of the frequency
+	Curve curve{ FrequencyGrid::logarithmic(pointCount, minFrequency, maxFrequency), {} };
+	curve.db.reserve(pointCount);
+	size_t segment = 1;
+	for (const double frequency : curve.grid.frequencies())
+	{
+		while (segment + 1 < frequencies.size() && frequencies[segment] < frequency)
+			++segment;
+
+		const double t = std::clamp(std::log(frequency / frequencies[segment - 1]) / std::log(frequencies[segment] / frequencies[segment - 1]), 0.0, 1.0);
+		curve.db.push_back(levels[segment - 1] + t * (levels[segment] - levels[segment - 1]));
+	}
+
+	return curve;
+}
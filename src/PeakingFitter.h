@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Filter.h"
+#include "FrequencyResponse.h"
+
+#include <QString>
+
+#include <expected>
+#include <vector>
+
+// Fits peaking filters to a target curve, to build a corrective EQ from a measurement or from the difference between
+// a headphone's response and a target. Levenberg-Marquardt on the log of fc, the gain and the log of Q of every filter,
+// with the analytic derivatives of the biquad magnitude, run from several starting points on all the cores.
+// The level of the target doesn't matter, a constant offset is fitted along with the filters and then left out.
+class PeakingFitter final {
+public:
+	struct Options {
+		size_t filterCount = 10;
+		// The first start places the filters one by one on the largest remaining error, the second one spreads them
+		// evenly over the grid and the others are random perturbations of the first one
+		size_t startCount = 8;
+		int maxIterations = 200;
+
+		// The limits of the editor
+		double minFc = 20.0;
+		double maxFc = 20000.0;
+		double maxGainDb = 20.0;
+		double minQ = 0.1;
+		double maxQ = 10.0;
+	};
+
+	struct Result {
+		FilterList filters; // A preamp that keeps the peak of the fitted response at 0 dB, then the filters by fc
+		double rmsErrorDb = 0.0;
+		int iterations = 0; // Of the best start
+	};
+
+	struct Curve {
+		FrequencyGrid grid;
+		std::vector<double> db;
+	};
+
+	// The target is in dB at every point of the grid
+	[[nodiscard]] static std::expected<Result, QString> fit(const FrequencyGrid& grid, const std::vector<double>& targetDb, const Options& options);
+
+	// Reads a curve with a "<frequency> <dB>" pair per line, as exported by REW or AutoEq, and resamples it on a
+	// logarithmic grid within 20 Hz - 20 kHz. Lines that don't start with two numbers are skipped.
+	[[nodiscard]] static std::expected<Curve, QString> readCurve(const QString& filePath, size_t pointCount = 1000);
+};
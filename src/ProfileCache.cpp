@@ -0,0 +1,306 @@
+#include "ProfileCache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// File layout: Header, EntryRecord[entryCount], FilterRecord[filterCount], char16_t[stringLength].
+// Every section starts 8-byte aligned so the records can be read in place from the mapping.
+// Numbers are stored in the native byte order, the cache is never shared between machines.
+
+namespace {
+
+inline constexpr char Magic[4] = { 'E', 'Q', 'P', 'C' };
+// Bump whenever the layout or the meaning of a field changes, or the parser or the response calculation do,
+// files of other versions are discarded
+inline constexpr uint32_t FormatVersion = 3;
+
+enum class FilterTag : uint8_t {
+	Preamp,
+	Biquad,
+	Unsupported,
+	Count
+};
+
+} // namespace
+
+struct ProfileCache::Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t filterCount;
+	uint64_t stringLength; // In UTF-16 code units
+};
+
+struct ProfileCache::EntryRecord {
+	int64_t size;
+	int64_t modified;
+	uint8_t hash[16];
+	uint32_t pathOffset, pathLength;
+	uint32_t errorOffset, errorLength;
+	uint32_t firstFilter, filterCount;
+	uint64_t enabledFilterCount;
+	double maxGainDb, minGainDb, requiredPreampDb;
+};
+
+struct ProfileCache::FilterRecord {
+	double params[3]; // Preamp: gain; biquads: fc, gain, q
+	uint32_t textOffset, textLength; // The original line of unsupported filters
+	FilterTag type;
+	BiquadType biquadType;
+	uint8_t enabled;
+	uint8_t reserved[5];
+};
+
+ProfileCache::ProfileCache(QString filePath) :
+	_filePath(std::move(filePath))
+{
+	map();
+}
+
+ProfileCache::~ProfileCache()
+{
+	unmap();
+}
+
+QString ProfileCache::defaultFilePath()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/profiles.cache";
+}
+
+QByteArray ProfileCache::contentHash(const QByteArray& contents)
+{
+	return QCryptographicHash::hash(contents, QCryptographicHash::Md5);
+}
+
+std::optional<ProfileCache::Entry> ProfileCache::find(const QString& profilePath) const
+{
+	if (const auto it = _inserted.constFind(profilePath); it != _inserted.cend())
+		return it.value();
+
+	if (const auto it = _mappedIndex.constFind(profilePath); it != _mappedIndex.cend())
+		return decode(_entries[it.value()]);
+
+	return std::nullopt;
+}
+
+void ProfileCache::insert(const QString& profilePath, Entry entry)
+{
+	_inserted.insert(profilePath, std::move(entry));
+}
+
+bool ProfileCache::isModified() const
+{
+	return !_inserted.isEmpty();
+}
+
+std::expected<void, QString> ProfileCache::save()
+{
+	// Everything is decoded first, the mapping has to be released before the file can be replaced
+	for (auto it = _mappedIndex.cbegin(); it != _mappedIndex.cend(); ++it)
+	{
+		if (!_inserted.contains(it.key()))
+			_inserted.insert(it.key(), decode(_entries[it.value()]));
+	}
+	unmap();
+
+	std::vector<EntryRecord> entryRecords;
+	std::vector<FilterRecord> filterRecords;
+	QString strings;
+
+	const auto addString = [&strings](const QString& string, uint32_t& offset, uint32_t& length) {
+		offset = static_cast<uint32_t>(strings.size());
+		length = static_cast<uint32_t>(string.size());
+		strings += string;
+	};
+
+	for (auto it = _inserted.cbegin(); it != _inserted.cend(); ++it)
+	{
+		const Entry& entry = it.value();
+		if (!QFileInfo::exists(it.key()) || entry.hash.size() != sizeof(EntryRecord::hash))
+			continue;
+
+		EntryRecord record{};
+		record.size = entry.size;
+		record.modified = entry.modified;
+		std::memcpy(record.hash, entry.hash.constData(), sizeof record.hash);
+		addString(it.key(), record.pathOffset, record.pathLength);
+		addString(entry.summary.error, record.errorOffset, record.errorLength);
+		record.firstFilter = static_cast<uint32_t>(filterRecords.size());
+		record.filterCount = static_cast<uint32_t>(entry.filters.size());
+		record.enabledFilterCount = entry.summary.filterCount;
+		record.maxGainDb = entry.summary.maxGainDb;
+		record.minGainDb = entry.summary.minGainDb;
+		record.requiredPreampDb = entry.summary.requiredPreampDb;
+		entryRecords.push_back(record);
+
+		for (const Filter& filter : entry.filters)
+		{
+			FilterRecord& filterRecord = filterRecords.emplace_back();
+			std::visit([&](const auto& f) {
+				using FilterType = std::decay_t<decltype(f)>;
+
+				filterRecord.enabled = f.isEnabled();
+				if constexpr (std::is_same_v<FilterType, PreampFilter>)
+				{
+					filterRecord.type = FilterTag::Preamp;
+					filterRecord.params[0] = f.gain();
+				}
+				else if constexpr (isBiquadFilter<FilterType>)
+				{
+					filterRecord.type = FilterTag::Biquad;
+					filterRecord.biquadType = FilterType::Type;
+					filterRecord.params[0] = f.fc();
+					filterRecord.params[1] = f.gain();
+					filterRecord.params[2] = f.q();
+				}
+				else
+				{
+					filterRecord.type = FilterTag::Unsupported;
+					addString(f.originalLine(), filterRecord.textOffset, filterRecord.textLength);
+				}
+			}, filter);
+		}
+	}
+
+	Header header{};
+	std::memcpy(header.magic, Magic, sizeof Magic);
+	header.version = FormatVersion;
+	header.entryCount = static_cast<uint32_t>(entryRecords.size());
+	header.filterCount = static_cast<uint32_t>(filterRecords.size());
+	header.stringLength = static_cast<uint64_t>(strings.size());
+
+	QDir().mkpath(QFileInfo(_filePath).absolutePath());
+	QSaveFile file(_filePath);
+	if (!file.open(QIODevice::WriteOnly))
+		return std::unexpected(QString("Failed to write the profile cache %1: %2").arg(_filePath, file.errorString()));
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof header);
+	file.write(reinterpret_cast<const char*>(entryRecords.data()), static_cast<qint64>(entryRecords.size() * sizeof(EntryRecord)));
+	file.write(reinterpret_cast<const char*>(filterRecords.data()), static_cast<qint64>(filterRecords.size() * sizeof(FilterRecord)));
+	file.write(reinterpret_cast<const char*>(strings.utf16()), strings.size() * static_cast<qint64>(sizeof(char16_t)));
+	if (!file.commit())
+		return std::unexpected(QString("Failed to write the profile cache %1: %2").arg(_filePath, file.errorString()));
+
+	_inserted.clear();
+	map();
+	return {};
+}
+
+void ProfileCache::map()
+{
+	static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) % 8 == 0);
+	static_assert(std::is_trivially_copyable_v<EntryRecord> && sizeof(EntryRecord) % 8 == 0);
+	static_assert(std::is_trivially_copyable_v<FilterRecord> && sizeof(FilterRecord) % 8 == 0);
+
+	_file.setFileName(_filePath);
+	if (!_file.open(QIODevice::ReadOnly))
+		return;
+
+	const auto fileSize = static_cast<uint64_t>(_file.size());
+	const uchar* data = fileSize >= sizeof(Header) ? _file.map(0, _file.size()) : nullptr;
+	if (!data)
+	{
+		unmap();
+		return;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof header);
+
+	const uint64_t entriesSize = uint64_t{ header.entryCount } * sizeof(EntryRecord);
+	const uint64_t filtersSize = uint64_t{ header.filterCount } * sizeof(FilterRecord);
+	const uint64_t stringsSize = header.stringLength * sizeof(char16_t);
+	if (std::memcmp(header.magic, Magic, sizeof Magic) != 0 || header.version != FormatVersion ||
+		header.stringLength > fileSize || sizeof(Header) + entriesSize + filtersSize + stringsSize != fileSize)
+	{
+		unmap();
+		return;
+	}
+
+	const uchar* entries = data + sizeof(Header);
+	const uchar* filters = entries + entriesSize;
+	const uchar* strings = filters + filtersSize;
+	_entries = { reinterpret_cast<const EntryRecord*>(entries), header.entryCount };
+	_filters = { reinterpret_cast<const FilterRecord*>(filters), header.filterCount };
+	_strings = { reinterpret_cast<const char16_t*>(strings), static_cast<size_t>(header.stringLength) };
+
+	// A corrupted file is discarded as a whole rather than trusting any of its offsets
+	const auto isValidString = [this](uint32_t offset, uint32_t length) {
+		return uint64_t{ offset } + length <= _strings.size();
+	};
+	bool valid = true;
+	for (const FilterRecord& filter : _filters)
+	{
+		valid = valid && filter.type < FilterTag::Count && isValidString(filter.textOffset, filter.textLength) &&
+			(filter.type != FilterTag::Biquad || filter.biquadType < BiquadType::Count);
+	}
+	for (const EntryRecord& entry : _entries)
+	{
+		valid = valid && isValidString(entry.pathOffset, entry.pathLength) && isValidString(entry.errorOffset, entry.errorLength) &&
+			uint64_t{ entry.firstFilter } + entry.filterCount <= _filters.size();
+	}
+
+	if (!valid)
+	{
+		unmap();
+		return;
+	}
+
+	_mappedIndex.reserve(static_cast<qsizetype>(_entries.size()));
+	for (size_t i = 0; i < _entries.size(); ++i)
+		_mappedIndex.insert(string(_entries[i].pathOffset, _entries[i].pathLength), i);
+}
+
+void ProfileCache::unmap()
+{
+	_mappedIndex.clear();
+	_entries = {};
+	_filters = {};
+	_strings = {};
+	_file.close(); // Also unmaps
+}
+
+ProfileCache::Entry ProfileCache::decode(const EntryRecord& record) const
+{
+	Entry entry;
+	entry.size = record.size;
+	entry.modified = record.modified;
+	entry.hash = QByteArray(reinterpret_cast<const char*>(record.hash), sizeof record.hash);
+	entry.summary.filterCount = static_cast<size_t>(record.enabledFilterCount);
+	entry.summary.maxGainDb = record.maxGainDb;
+	entry.summary.minGainDb = record.minGainDb;
+	entry.summary.requiredPreampDb = record.requiredPreampDb;
+	entry.summary.error = string(record.errorOffset, record.errorLength);
+
+	entry.filters.reserve(record.filterCount);
+	for (const FilterRecord& filter : _filters.subspan(record.firstFilter, record.filterCount))
+	{
+		const bool enabled = filter.enabled != 0;
+		switch (filter.type)
+		{
+		case FilterTag::Preamp:
+			entry.filters.emplace_back(PreampFilter{ filter.params[0], enabled });
+			break;
+		case FilterTag::Biquad:
+			entry.filters.push_back(makeBiquadFilter(filter.biquadType, filter.params[0], filter.params[1], filter.params[2], enabled));
+			break;
+		default:
+			entry.filters.emplace_back(UnsupportedFilter{ string(filter.textOffset, filter.textLength), enabled });
+			break;
+		}
+	}
+
+	return entry;
+}
+
+QString ProfileCache::string(uint32_t offset, uint32_t length) const
+{
+	return QString(reinterpret_cast<const QChar*>(_strings.data() + offset), length);
+}
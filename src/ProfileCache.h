@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Filter.h"
+#include "ProfileScanner.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+#include <expected>
+#include <optional>
+#include <span>
+
+// Parsed profiles and their summaries stored in a binary file that is memory-mapped on load,
+// so that the profiles that haven't changed since the last run don't need to be read and parsed again.
+// Lookups are thread-safe, insert() and save() are not.
+class ProfileCache final {
+public:
+	struct Entry {
+		qint64 size = 0;
+		qint64 modified = 0; // Milliseconds since the epoch
+		QByteArray hash; // Of the file contents, see contentHash()
+		ProfileSummary summary;
+		FilterList filters;
+	};
+
+	explicit ProfileCache(QString filePath);
+	~ProfileCache();
+
+	ProfileCache(const ProfileCache&) = delete;
+	ProfileCache& operator=(const ProfileCache&) = delete;
+
+	// profiles.cache in the user cache directory
+	[[nodiscard]] static QString defaultFilePath();
+	[[nodiscard]] static QByteArray contentHash(const QByteArray& contents);
+
+	[[nodiscard]] std::optional<Entry> find(const QString& profilePath) const;
+	void insert(const QString& profilePath, Entry entry);
+
+	[[nodiscard]] bool isModified() const;
+	// Writes all the entries whose profile still exists, the file is replaced atomically
+	[[nodiscard]] std::expected<void, QString> save();
+
+private:
+	struct Header;
+	struct EntryRecord;
+	struct FilterRecord;
+
+	void map();
+	void unmap();
+
+	[[nodiscard]] Entry decode(const EntryRecord& record) const;
+	[[nodiscard]] QString string(uint32_t offset, uint32_t length) const;
+
+	const QString _filePath;
+
+	QFile _file;
+	std::span<const EntryRecord> _entries;
+	std::span<const FilterRecord> _filters;
+	std::span<const char16_t> _strings;
+	QHash<QString, size_t> _mappedIndex; // Profile path -> index into _entries
+
+	QHash<QString, Entry> _inserted;
+};
@@ -1,19 +1,31 @@
 #include "ProfileEditorWindow.h"
+#include "PeakingFitter.h"
 #include "ProfileParser.h"
 
 #include <QCheckBox>
+#include <QComboBox>
 #include <QDoubleSpinBox>
+#include <QFileDialog>
 #include <QFileInfo>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QInputDialog>
 #include <QLabel>
 #include <QMessageBox>
+#include <QPromise>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QShortcut>
 #include <QSplitter>
 #include <QVBoxLayout>
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <variant>
+
 ProfileEditorWindow::ProfileEditorWindow(const QString& profilePath, QWidget* parent)
 	: QMainWindow(parent), _profilePath(profilePath)
 {
@@ -61,6 +73,10 @@ ProfileEditorWindow::ProfileEditorWindow(const QString& profilePath, QWidget* pa
 	connect(addPkButton, &QPushButton::clicked, this, &ProfileEditorWindow::addPeakingFilter);
 	filtersLayout->addWidget(addPkButton);
 
+	_fitButton = new QPushButton("Fit Peaking Filters to a Curve...", this);
+	connect(_fitButton, &QPushButton::clicked, this, &ProfileEditorWindow::fitToCurve);
+	filtersLayout->addWidget(_fitButton);
+
 	mainSplitter->addWidget(filtersContainer);
 	mainSplitter->setStretchFactor(0, 1);
 	mainSplitter->setStretchFactor(1, 2);
@@ -70,6 +86,14 @@ ProfileEditorWindow::ProfileEditorWindow(const QString& profilePath, QWidget* pa
 
 	// Bottom buttons - pinned at the bottom
 	QHBoxLayout* buttonLayout = new QHBoxLayout();
+
+	// In the order of FrequencyResponseWidget::SecondaryTrace
+	QComboBox* traceCombo = new QComboBox(this);
+	traceCombo->addItems({ "Magnitude", "Magnitude and phase", "Magnitude and group delay" });
+	connect(traceCombo, &QComboBox::currentIndexChanged, this, [this](int index) {
+		_responseWidget->setSecondaryTrace(static_cast<FrequencyResponseWidget::SecondaryTrace>(index));
+	});
+	buttonLayout->addWidget(traceCombo);
 	buttonLayout->addStretch();
 
 	QPushButton* saveButton = new QPushButton("Save", this);
@@ -88,6 +112,7 @@ ProfileEditorWindow::ProfileEditorWindow(const QString& profilePath, QWidget* pa
 	connect(escShortcut, &QShortcut::activated, this, &ProfileEditorWindow::close);
 
 	loadProfile();
+	_fileWatcher.setFiles({ _profilePath });
 }
 
 void ProfileEditorWindow::loadProfile()
@@ -100,9 +125,9 @@ void ProfileEditorWindow::loadProfile()
 		return;
 	}
 
-	_filters = std::move(result.value().filters);
+	_profile = std::move(result.value());
+	_responseWidget->setFilters(_profile.filters);
 	rebuildFilterUI();
-	_responseWidget->setFilters(_filters);
 }
 
 void ProfileEditorWindow::rebuildFilterUI()
@@ -117,14 +142,23 @@ void ProfileEditorWindow::rebuildFilterUI()
 	}
 
 	// Create widgets for each filter
-	for (size_t i = 0; i < _filters.size(); ++i)
+	for (size_t i = 0; i < _profile.filters.size(); ++i)
 	{
-		createFilterWidget(_filterListLayout, _filters[i].get(), static_cast<int>(i));
+		createFilterWidget(_filterListLayout, _profile.filters[i], static_cast<int>(i));
 	}
+
+	// Filters may have been added or removed, this also covers any pending changes
+	_updateScheduler.cancel();
+	_changedFilters.clear();
+	_responseWidget->syncFilters();
+	_responseWidget->setChannelFilters(_profile.channelFilters());
 }
 
-void ProfileEditorWindow::createFilterWidget(QVBoxLayout* layout, IFilter* filter, int index)
+void ProfileEditorWindow::createFilterWidget(QVBoxLayout* layout, Filter& filterItem, int index)
 {
+	// The pointers captured below stay valid until the filter list changes, which also rebuilds this UI
+	IFilter* filter = &asIFilter(filterItem);
+
 	QGroupBox* filterBox = new QGroupBox(this);
 	QHBoxLayout* boxLayout = new QHBoxLayout(filterBox);
 	boxLayout->setContentsMargins(0, 1, 0, 1);
@@ -133,13 +167,13 @@ void ProfileEditorWindow::createFilterWidget(QVBoxLayout* layout, IFilter* filte
 	// Enable checkbox
 	QCheckBox* enableCheck = new QCheckBox(filterBox);
 	enableCheck->setChecked(filter->isEnabled());
-	connect(enableCheck, &QCheckBox::toggled, this, [this, filter](bool checked) {
+	connect(enableCheck, &QCheckBox::toggled, this, [this, filter, index](bool checked) {
 		filter->setEnabled(checked);
-		onFilterChanged();
+		onFilterChanged(index);
 	});
 	boxLayout->addWidget(enableCheck);
 
-	if (auto* preamp = dynamic_cast<PreampFilter*>(filter))
+	if (auto* preamp = std::get_if<PreampFilter>(&filterItem))
 	{
 		// Preamp controls
 		boxLayout->addWidget(new QLabel("Preamp Gain:", filterBox));
@@ -149,72 +183,86 @@ void ProfileEditorWindow::createFilterWidget(QVBoxLayout* layout, IFilter* filte
 		gainSpin->setSingleStep(0.5);
 		gainSpin->setSuffix(" dB");
 		gainSpin->setValue(preamp->gain());
-		connect(gainSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, preamp](double value) {
+		connect(gainSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, preamp, index](double value) {
 			preamp->setGain(value);
-			onFilterChanged();
-		});
-		boxLayout->addWidget(gainSpin);
-	}
-	else if (auto* pk = dynamic_cast<PeakingFilter*>(filter))
-	{
-		// Peaking filter controls
-		boxLayout->addWidget(new QLabel("Peak", filterBox));
-
-		boxLayout->addWidget(new QLabel("Frequency:", filterBox));
-		QDoubleSpinBox* fcSpin = new QDoubleSpinBox(filterBox);
-		fcSpin->setRange(15.0, 20000.0);
-		fcSpin->setSingleStep(10.0);
-		fcSpin->setSuffix(" Hz");
-		fcSpin->setValue(pk->fc());
-		connect(fcSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, pk](double value) {
-			pk->setFc(value);
-			onFilterChanged();
-		});
-		boxLayout->addWidget(fcSpin);
-
-		boxLayout->addWidget(new QLabel("Gain:", filterBox));
-		QDoubleSpinBox* gainSpin = new QDoubleSpinBox(filterBox);
-		gainSpin->setRange(-20.0, 20.0);
-		gainSpin->setSingleStep(0.1);
-		gainSpin->setSuffix(" dB");
-		gainSpin->setValue(pk->gain());
-		connect(gainSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, pk](double value) {
-			pk->setGain(value);
-			onFilterChanged();
+			onFilterChanged(index);
 		});
 		boxLayout->addWidget(gainSpin);
-
-		boxLayout->addWidget(new QLabel("Q:", filterBox));
-		QDoubleSpinBox* qSpin = new QDoubleSpinBox(filterBox);
-		qSpin->setRange(0.1, 10.0);
-		qSpin->setSingleStep(0.1);
-		qSpin->setValue(pk->q());
-		connect(qSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, pk](double value) {
-			pk->setQ(value);
-			onFilterChanged();
-		});
-		boxLayout->addWidget(qSpin);
-
-		// Delete button
-		QPushButton* deleteBtn = new QPushButton("Delete", filterBox);
-		connect(deleteBtn, &QPushButton::clicked, this, [this, index]() {
-			if (index >= 0 && static_cast<size_t>(index) < _filters.size())
-			{
-				_filters.erase(_filters.begin() + index);
-				rebuildFilterUI();
-				onFilterChanged();
-			}
-		});
-		boxLayout->addStretch(1);
-		boxLayout->addWidget(deleteBtn);
 	}
-	else if (auto* unsupported = dynamic_cast<UnsupportedFilter*>(filter))
+	else if (auto* unsupported = std::get_if<UnsupportedFilter>(&filterItem))
 	{
 		// Unsupported filter - just show info
 		QLabel* label = new QLabel("[Unsupported] " + unsupported->originalLine(), filterBox);
 		label->setStyleSheet("color: gray;");
 		boxLayout->addWidget(label);
 	}
+	else
+	{
+		// Biquad filter controls, only for the parameters of the type
+		std::visit([&](auto& biquad) {
+			using FilterType = std::decay_t<decltype(biquad)>;
+			if constexpr (isBiquadFilter<FilterType>)
+			{
+				auto* f = &biquad;
+				boxLayout->addWidget(new QLabel(FilterType::Traits.name, filterBox));
+
+				boxLayout->addWidget(new QLabel("Frequency:", filterBox));
+				QDoubleSpinBox* fcSpin = new QDoubleSpinBox(filterBox);
+				fcSpin->setRange(15.0, 20000.0);
+				fcSpin->setSingleStep(10.0);
+				fcSpin->setSuffix(" Hz");
+				fcSpin->setValue(f->fc());
+				connect(fcSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, f, index](double value) {
+					f->setFc(value);
+					onFilterChanged(index);
+				});
+				boxLayout->addWidget(fcSpin);
+
+				if constexpr (FilterType::Traits.hasGain)
+				{
+					boxLayout->addWidget(new QLabel("Gain:", filterBox));
+					QDoubleSpinBox* gainSpin = new QDoubleSpinBox(filterBox);
+					gainSpin->setRange(-20.0, 20.0);
+					gainSpin->setSingleStep(0.1);
+					gainSpin->setSuffix(" dB");
+					gainSpin->setValue(f->gain());
+					connect(gainSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, f, index](double value) {
+						f->setGain(value);
+						onFilterChanged(index);
+					});
+					boxLayout->addWidget(gainSpin);
+				}
+
+				// LS and HS have a fixed slope
+				if constexpr (FilterType::Traits.q != QUsage::None)
+				{
+					boxLayout->addWidget(new QLabel("Q:", filterBox));
+					QDoubleSpinBox* qSpin = new QDoubleSpinBox(filterBox);
+					qSpin->setRange(0.1, 10.0);
+					qSpin->setSingleStep(0.1);
+					qSpin->setDecimals(3); // Enough for the Butterworth Q of 0.707
+					qSpin->setValue(f->q());
+					connect(qSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, f, index](double value) {
+						f->setQ(value);
+						onFilterChanged(index);
+					});
+					boxLayout->addWidget(qSpin);
+				}
+
+				// Delete button
+				QPushButton* deleteBtn = new QPushButton("Delete", filterBox);
+				connect(deleteBtn, &QPushButton::clicked, this, [this, index]() {
+					if (index >= 0 && static_cast<size_t>(index) < _profile.filters.size())
+					{
+						_profile.removeFilter(static_cast<size_t>(index));
+						rebuildFilterUI();
+					}
+				});
+				boxLayout->addStretch(1);
+				boxLayout->addWidget(deleteBtn);
+			}
+		}, filterItem);
+	}
 
 	boxLayout->addStretch();
 	layout->addWidget(filterBox);
@@ -223,14 +271,92 @@ void ProfileEditorWindow::createFilterWidget(QVBoxLayout* layout, IFilter* filte
 void ProfileEditorWindow::addPeakingFilter()
 {
 	// Add a default peaking filter
-	_filters.push_back(std::make_unique<PeakingFilter>(1000.0, 0.0, 1.0, true));
+	_profile.appendFilter(PeakingFilter{ 1000.0, 0.0, 1.0, true });
 	rebuildFilterUI();
-	onFilterChanged();
+}
+
+void ProfileEditorWindow::fitToCurve()
+{
+	const QString curvePath = QFileDialog::getOpenFileName(this, "Target Curve", QFileInfo(_profilePath).path(), "Curves (*.txt *.csv);;All Files (*)");
+	if (curvePath.isEmpty())
+		return;
+
+	bool ok = false;
+	PeakingFitter::Options options;
+	options.filterCount = static_cast<size_t>(QInputDialog::getInt(this, "Fit to Curve", "Number of peaking filters:", 10, 1, 30, 1, &ok));
+	if (!ok)
+		return;
+
+	// Only the peaking filters and the preamp are replaced, the new peaking filters are fitted to what the other
+	// filters leave of the target
+	FilterList kept;
+	std::copy_if(_profile.filters.begin(), _profile.filters.end(), std::back_inserter(kept), [](const Filter& filter) {
+		return !std::holds_alternative<PeakingFilter>(filter) && !std::holds_alternative<PreampFilter>(filter);
+	});
+
+	// Up to a few seconds with many filters, the window stays responsive meanwhile
+	_fitButton->setEnabled(false);
+	setCursor(Qt::BusyCursor);
+
+	// QThreadPool needs a copyable task, QPromise is move-only
+	using FitResult = std::expected<PeakingFitter::Result, QString>;
+	auto promise = std::make_shared<QPromise<FitResult>>();
+	QFuture<FitResult> future = promise->future();
+	promise->start();
+
+	_fitPool.start([promise, curvePath, options, kept] {
+		promise->addResult([&]() -> FitResult {
+			auto curve = PeakingFitter::readCurve(curvePath);
+			if (!curve)
+				return std::unexpected(curve.error());
+
+			const std::vector<double> keptDb = calculateFrequencyResponse(kept, curve->grid);
+			for (size_t i = 0; i < keptDb.size(); ++i)
+				curve->db[i] -= keptDb[i];
+
+			auto result = PeakingFitter::fit(curve->grid, curve->db, options);
+			if (!result)
+				return result;
+
+			// The preamp keeps the peak of the whole chain at 0 dB, not only the one of the fitted filters
+			FilterList chain = kept;
+			chain.insert(chain.end(), result->filters.begin() + 1, result->filters.end());
+			const std::vector<double> chainDb = calculateFrequencyResponse(chain, curve->grid);
+			const double peak = std::max(0.0, *std::max_element(chainDb.begin(), chainDb.end()));
+			result->filters.front() = PreampFilter{ -std::ceil(peak * 10.0) / 10.0 };
+			return result;
+		}());
+		promise->finish();
+	});
+
+	future.then(this, [this, filterCount = options.filterCount](FitResult result) {
+		_fitButton->setEnabled(true);
+		unsetCursor();
+		if (!result)
+		{
+			QMessageBox::critical(this, "Error", result.error());
+			return;
+		}
+
+		// The fitted filters replace the peaking filters and the preamps, the other filters and lines of the file stay
+		for (size_t i = _profile.filters.size(); i-- > 0;)
+		{
+			if (std::holds_alternative<PeakingFilter>(_profile.filters[i]) || std::holds_alternative<PreampFilter>(_profile.filters[i]))
+				_profile.removeFilter(i);
+		}
+		for (Filter& filter : result->filters)
+			_profile.appendFilter(std::move(filter));
+		rebuildFilterUI();
+
+		QMessageBox::information(this, "Fit to Curve", QString("Fitted %1 peaking filters, the RMS error is %2 dB.\nSave to keep them.")
+			.arg(filterCount).arg(result->rmsErrorDb, 0, 'f', 2));
+	});
 }
 
 void ProfileEditorWindow::saveProfile()
 {
-	auto result = ProfileParser::saveProfile(_profilePath, _filters);
+	_fileWatcher.noteOwnWrite(_profilePath, _profile.toText().toUtf8());
+	auto result = ProfileParser::saveProfile(_profilePath, _profile);
 	if (!result.has_value())
 	{
 		QMessageBox::critical(this, "Error", "Failed to save profile:\n" + result.error());
@@ -241,7 +367,29 @@ void ProfileEditorWindow::saveProfile()
 	close();
 }
 
-void ProfileEditorWindow::onFilterChanged()
+void ProfileEditorWindow::onFilterChanged(int index)
 {
-	_responseWidget->updateResponse();
+	const auto filterIndex = static_cast<size_t>(index);
+	if (std::find(_changedFilters.begin(), _changedFilters.end(), filterIndex) == _changedFilters.end())
+		_changedFilters.push_back(filterIndex);
+
+	_updateScheduler.schedule();
+}
+
+void ProfileEditorWindow::updateChangedFilters()
+{
+	_responseWidget->updateFilters(_changedFilters);
+	_responseWidget->setChannelFilters(_profile.channelFilters()); // Empty unless the profile has Channel lines
+	_changedFilters.clear();
+}
+
+void ProfileEditorWindow::onProfileChangedOnDisk()
+{
+	if (_profile.isModified() && QMessageBox::question(this, "Profile Changed",
+		"The profile has been changed by another program.\nReload it and discard your changes?") != QMessageBox::Yes)
+	{
+		return;
+	}
+
+	loadProfile();
 }
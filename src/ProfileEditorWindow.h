@@ -1,9 +1,13 @@
 #pragma once
 
+#include "FileChangeWatcher.h"
 #include "Filter.h"
 #include "FrequencyResponseWidget.h"
+#include "ProfileParser.h"
+#include "UpdateScheduler.h"
 
 #include <QMainWindow>
+#include <QThreadPool>
 
 #include <vector>
 
@@ -19,19 +23,32 @@ public:
 
 private slots:
 	void addPeakingFilter();
+	void fitToCurve();
 	void saveProfile();
-	void onFilterChanged();
+	void onFilterChanged(int index);
 
 private:
 	void loadProfile();
 	void rebuildFilterUI();
-	void createFilterWidget(QVBoxLayout* layout, IFilter* filter, int index);
+	void createFilterWidget(QVBoxLayout* layout, Filter& filterItem, int index);
+	void updateChangedFilters();
+	void onProfileChangedOnDisk();
 
 private:
 	const QString _profilePath;
-	std::vector<FilterUniquePtr> _filters;
+	ProfileData _profile;
 
 	QScrollArea* _filterScrollArea = nullptr;
 	QVBoxLayout* _filterListLayout = nullptr;
 	FrequencyResponseWidget* _responseWidget = nullptr;
+	QPushButton* _fitButton = nullptr;
+
+	// Spinbox changes are applied to the response at most once per display frame
+	std::vector<size_t> _changedFilters;
+	UpdateScheduler _updateScheduler{ [this] { updateChangedFilters(); } };
+
+	FileChangeWatcher _fileWatcher{ [this](const QStringList&) { onProfileChangedOnDisk(); } };
+
+	// Runs the fits, its destructor waits for the one in progress
+	QThreadPool _fitPool;
 };
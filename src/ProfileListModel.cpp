@@ -0,0 +1,206 @@
+#include "ProfileListModel.h"
+#include "ProfileThumbnails.h"
+
+#include <QPixmap>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+ProfileListModel::ProfileListModel(ProfileThumbnails& thumbnails, std::function<void()> onCheckedChanged, QObject* parent) :
+	QAbstractListModel(parent),
+	_thumbnails(thumbnails),
+	_onCheckedChanged(std::move(onCheckedChanged))
+{
+}
+
+void ProfileListModel::setProfiles(const std::vector<EqProfile>& profiles)
+{
+	beginResetModel();
+
+	_items.clear();
+	_items.reserve(profiles.size());
+	_checkedRows.clear();
+
+	for (const EqProfile& profile : profiles)
+	{
+		if (profile.enabled)
+			_checkedRows.push_back(static_cast<int>(_items.size()));
+
+		_items.push_back(makeItem(profile));
+	}
+
+	endResetModel();
+}
+
+void ProfileListModel::applyDiff(const std::vector<EqProfile>& profiles, const ConfigDiff& diff)
+{
+	const int first = static_cast<int>(diff.first);
+	const int removedCount = static_cast<int>(diff.removedCount);
+	const int addedCount = static_cast<int>(diff.addedCount);
+
+	std::erase_if(_checkedRows, [&](int row) { return row >= first && row < first + removedCount; });
+	for (int& row : _checkedRows)
+	{
+		if (row >= first + removedCount)
+			row += addedCount - removedCount;
+	}
+
+	if (removedCount > 0)
+	{
+		beginRemoveRows({}, first, first + removedCount - 1);
+		_items.erase(_items.begin() + first, _items.begin() + first + removedCount);
+		endRemoveRows();
+	}
+
+	if (addedCount > 0)
+	{
+		beginInsertRows({}, first, first + addedCount - 1);
+		std::vector<Item> addedItems;
+		addedItems.reserve(diff.addedCount);
+		for (size_t i = diff.first; i < diff.first + diff.addedCount; ++i)
+		{
+			if (profiles[i].enabled)
+				_checkedRows.push_back(static_cast<int>(i));
+
+			addedItems.push_back(makeItem(profiles[i]));
+		}
+		_items.insert(_items.begin() + first, std::make_move_iterator(addedItems.begin()), std::make_move_iterator(addedItems.end()));
+		endInsertRows();
+	}
+
+	for (const size_t toggledRow : diff.toggled)
+	{
+		const int row = static_cast<int>(toggledRow);
+		const bool checked = profiles[toggledRow].enabled;
+		_items[toggledRow].checked = checked;
+		if (checked)
+			_checkedRows.push_back(row);
+		else
+			std::erase(_checkedRows, row);
+
+		emit dataChanged(index(row), index(row), { Qt::CheckStateRole });
+	}
+
+	assert(_items.size() == profiles.size());
+}
+
+void ProfileListModel::setIndex(ProfileIndex index)
+{
+	_index = std::move(index);
+
+	if (!_items.empty())
+		emit dataChanged(this->index(0), this->index(rowCount() - 1), { Qt::ToolTipRole, Qt::DecorationRole });
+}
+
+void ProfileListModel::onThumbnailReady(const QByteArray& /*hash*/)
+{
+	// Only the visible rows request thumbnails and the view only repaints the visible rows,
+	// so this is cheaper than tracking which rows use the thumbnail
+	if (!_items.empty())
+		emit dataChanged(index(0), index(rowCount() - 1), { Qt::DecorationRole });
+}
+
+int ProfileListModel::firstCheckedRow() const
+{
+	return _checkedRows.empty() ? -1 : *std::min_element(_checkedRows.begin(), _checkedRows.end());
+}
+
+int ProfileListModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : static_cast<int>(_items.size());
+}
+
+QVariant ProfileListModel::data(const QModelIndex& index, int role) const
+{
+	if (!checkIndex(index, CheckIndexOption::IndexIsValid))
+		return {};
+
+	const Item& item = _items[static_cast<size_t>(index.row())];
+	switch (role)
+	{
+	case Qt::DisplayRole:
+		return item.displayName;
+	case Qt::CheckStateRole:
+		return item.checked ? Qt::Checked : Qt::Unchecked;
+	case FileNameRole:
+		return item.fileName;
+	case Qt::ToolTipRole:
+		if (const auto it = _index.constFind(item.fileName); it != _index.cend())
+			return toolTip(it.value());
+		return {};
+	case Qt::DecorationRole:
+		// Only the rows that are actually painted get their thumbnails rendered, the profiles that can't be parsed have none
+		if (const auto it = _index.constFind(item.fileName); it != _index.cend() && it.value().error.isEmpty())
+		{
+			if (const QPixmap thumbnail = _thumbnails.thumbnail(it.value().filters, it.value().hash); !thumbnail.isNull())
+				return thumbnail;
+		}
+		return {};
+	default:
+		return {};
+	}
+}
+
+bool ProfileListModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+	if (role != Qt::CheckStateRole || !checkIndex(index, CheckIndexOption::IndexIsValid))
+		return false;
+
+	const int row = index.row();
+	const bool checked = value.toInt() == Qt::Checked;
+	if (_items[static_cast<size_t>(row)].checked == checked)
+		return true;
+
+	_items[static_cast<size_t>(row)].checked = checked;
+	emit dataChanged(index, index, { Qt::CheckStateRole });
+
+	if (checked)
+	{
+		for (const int other : _checkedRows)
+		{
+			_items[static_cast<size_t>(other)].checked = false;
+			emit dataChanged(this->index(other), this->index(other), { Qt::CheckStateRole });
+		}
+		_checkedRows.assign(1, row);
+	}
+	else
+	{
+		std::erase(_checkedRows, row);
+	}
+
+	_onCheckedChanged();
+	return true;
+}
+
+Qt::ItemFlags ProfileListModel::flags(const QModelIndex& index) const
+{
+	if (!checkIndex(index, CheckIndexOption::IndexIsValid))
+		return Qt::NoItemFlags;
+
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable | Qt::ItemNeverHasChildren;
+}
+
+ProfileListModel::Item ProfileListModel::makeItem(const EqProfile& profile)
+{
+	QString displayName = profile.name;
+	if (displayName.endsWith(".txt", Qt::CaseInsensitive))
+		displayName.chop(4);
+
+	return { profile.name, std::move(displayName), profile.enabled };
+}
+
+QString ProfileListModel::toolTip(const ProfileSummary& summary)
+{
+	if (!summary.error.isEmpty())
+		return "Error: " + summary.error;
+
+	QString text = QString("%1 filters, %2 to %3 dB")
+		.arg(summary.filterCount)
+		.arg(summary.minGainDb, 0, 'f', 1)
+		.arg(summary.maxGainDb, 0, 'f', 1);
+	if (summary.requiredPreampDb < 0.0)
+		text += QString("\nNeeds %1 dB preamp to avoid clipping").arg(summary.requiredPreampDb, 0, 'f', 1);
+
+	return text;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "EqApoConfig.h"
+#include "ProfileScanner.h"
+
+#include <QAbstractListModel>
+
+#include <functional>
+#include <vector>
+
+class ProfileThumbnails;
+
+// The profiles included by config.txt, one row each. At most one profile is checked at a time
+// (unless config.txt itself enables several), checking one unchecks the others.
+// DisplayRole: the name without the .txt extension; CheckStateRole: whether the profile is enabled;
+// ToolTipRole: the summary from the scanner; DecorationRole: the response thumbnail, rendered on demand.
+class ProfileListModel final : public QAbstractListModel {
+public:
+	// The path of the profile file relative to the config folder, as written in config.txt
+	static constexpr int FileNameRole = Qt::UserRole;
+
+	// onCheckedChanged is called once for every user change of the checked profile
+	ProfileListModel(ProfileThumbnails& thumbnails, std::function<void()> onCheckedChanged, QObject* parent = nullptr);
+
+	void setProfiles(const std::vector<EqProfile>& profiles);
+	// Updates only the rows that the reload has changed, profiles is the new list
+	void applyDiff(const std::vector<EqProfile>& profiles, const ConfigDiff& diff);
+	void setIndex(ProfileIndex index);
+	// Called when a thumbnail that has been requested through DecorationRole is ready
+	void onThumbnailReady(const QByteArray& hash);
+
+	[[nodiscard]] bool isChecked(int row) const { return _items[static_cast<size_t>(row)].checked; }
+	// The first checked row, -1 if none is checked
+	[[nodiscard]] int firstCheckedRow() const;
+
+	[[nodiscard]] int rowCount(const QModelIndex& parent = {}) const override;
+	[[nodiscard]] QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+	[[nodiscard]] Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+private:
+	struct Item {
+		QString fileName;
+		QString displayName;
+		bool checked = false;
+	};
+
+	[[nodiscard]] static Item makeItem(const EqProfile& profile);
+	[[nodiscard]] static QString toolTip(const ProfileSummary& summary);
+
+	ProfileThumbnails& _thumbnails;
+	const std::function<void()> _onCheckedChanged;
+
+	std::vector<Item> _items;
+	std::vector<int> _checkedRows; // Usually just one, this keeps changing the checked profile O(1)
+
+	ProfileIndex _index;
+};
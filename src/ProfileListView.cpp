@@ -0,0 +1,155 @@
+#include "ProfileListView.h"
+
+#include <QApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QStyle>
+#include <QStyledItemDelegate>
+
+#include <algorithm>
+
+namespace {
+
+inline constexpr int ItemMargin = 2;
+
+QStyle* styleOf(const QWidget* widget)
+{
+	return widget ? widget->style() : QApplication::style();
+}
+
+int itemHeight(const QWidget* widget, const QFontMetrics& fontMetrics, QSize thumbnailSize)
+{
+	const int indicatorHeight = styleOf(widget)->pixelMetric(QStyle::PM_ExclusiveIndicatorHeight, nullptr, widget);
+	return std::max({ indicatorHeight, thumbnailSize.height(), fontMetrics.height() }) + 2 * ItemMargin;
+}
+
+// Paints a profile as a radio button followed by its thumbnail and name, the name in bold when checked
+class ProfileItemDelegate final : public QStyledItemDelegate {
+public:
+	ProfileItemDelegate(QSize thumbnailSize, QObject* parent) :
+		QStyledItemDelegate(parent),
+		_thumbnailSize(thumbnailSize)
+	{
+	}
+
+	void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override
+	{
+		QStyleOptionViewItem itemOption = option;
+		initStyleOption(&itemOption, index);
+
+		const QWidget* widget = option.widget;
+		QStyle* style = styleOf(widget);
+		const bool checked = itemOption.checkState == Qt::Checked;
+
+		// Hover and focus background
+		style->drawPrimitive(QStyle::PE_PanelItemViewItem, &itemOption, painter, widget);
+
+		const int spacing = style->pixelMetric(QStyle::PM_RadioButtonLabelSpacing, nullptr, widget);
+		const QRect content = option.rect.adjusted(ItemMargin, ItemMargin, -ItemMargin, -ItemMargin);
+		int x = content.left();
+
+		QStyleOptionButton radio;
+		if (widget)
+			radio.initFrom(widget);
+		const int indicatorWidth = style->pixelMetric(QStyle::PM_ExclusiveIndicatorWidth, nullptr, widget);
+		const int indicatorHeight = style->pixelMetric(QStyle::PM_ExclusiveIndicatorHeight, nullptr, widget);
+		radio.rect = QRect(x, content.center().y() - indicatorHeight / 2, indicatorWidth, indicatorHeight);
+		radio.state = (itemOption.state & (QStyle::State_Enabled | QStyle::State_MouseOver)) | (checked ? QStyle::State_On : QStyle::State_Off);
+		style->drawPrimitive(QStyle::PE_IndicatorRadioButton, &radio, painter, widget);
+		x += indicatorWidth + spacing;
+
+		// Missing until it has been rendered, its space is reserved anyway so the name doesn't move
+		if (const QPixmap thumbnail = index.data(Qt::DecorationRole).value<QPixmap>(); !thumbnail.isNull())
+			painter->drawPixmap(x, content.center().y() - _thumbnailSize.height() / 2, thumbnail);
+		x += _thumbnailSize.width() + spacing;
+
+		QFont font = itemOption.font;
+		font.setBold(checked);
+		const QRect textRect(x, content.top(), std::max(0, content.right() - x + 1), content.height());
+		const QString text = QFontMetrics(font).elidedText(itemOption.text, Qt::ElideRight, textRect.width());
+
+		painter->save();
+		painter->setFont(font);
+		painter->setPen(itemOption.palette.color(QPalette::Text));
+		painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter, text);
+		painter->restore();
+	}
+
+	QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override
+	{
+		const QWidget* widget = option.widget;
+		QStyle* style = styleOf(widget);
+		const int spacing = style->pixelMetric(QStyle::PM_RadioButtonLabelSpacing, nullptr, widget);
+		const int indicatorWidth = style->pixelMetric(QStyle::PM_ExclusiveIndicatorWidth, nullptr, widget);
+
+		QFont font = option.font;
+		font.setBold(true);
+		const int textWidth = QFontMetrics(font).horizontalAdvance(index.data(Qt::DisplayRole).toString());
+
+		return { indicatorWidth + spacing + _thumbnailSize.width() + spacing + textWidth + 2 * ItemMargin,
+			itemHeight(widget, option.fontMetrics, _thumbnailSize) };
+	}
+
+	bool editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option, const QModelIndex& index) override
+	{
+		bool toggle = false;
+		if (event->type() == QEvent::MouseButtonRelease)
+		{
+			const auto* mouseEvent = static_cast<QMouseEvent*>(event);
+			toggle = mouseEvent->button() == Qt::LeftButton && option.rect.contains(mouseEvent->position().toPoint());
+		}
+		else if (event->type() == QEvent::KeyPress)
+		{
+			const int key = static_cast<QKeyEvent*>(event)->key();
+			toggle = key == Qt::Key_Space || key == Qt::Key_Select;
+		}
+
+		if (!toggle)
+			return false;
+
+		const bool checked = index.data(Qt::CheckStateRole).toInt() == Qt::Checked;
+		return model->setData(index, checked ? Qt::Unchecked : Qt::Checked, Qt::CheckStateRole);
+	}
+
+private:
+	const QSize _thumbnailSize;
+};
+
+} // namespace
+
+ProfileListView::ProfileListView(QSize thumbnailSize, QWidget* parent) :
+	QListView(parent),
+	_thumbnailSize(thumbnailSize)
+{
+	setItemDelegate(new ProfileItemDelegate(thumbnailSize, this));
+
+	// Rows of ColumnCount profiles
+	setViewMode(QListView::ListMode);
+	setFlow(QListView::LeftToRight);
+	setWrapping(true);
+	setResizeMode(QListView::Adjust);
+	setUniformItemSizes(true);
+
+	setSelectionMode(QAbstractItemView::NoSelection);
+	setEditTriggers(QAbstractItemView::NoEditTriggers);
+	setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+	setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+	setMouseTracking(true);
+
+	updateGridSize();
+}
+
+void ProfileListView::resizeEvent(QResizeEvent* event)
+{
+	updateGridSize();
+	QListView::resizeEvent(event);
+}
+
+void ProfileListView::updateGridSize()
+{
+	const QSize cellSize(std::max(1, viewport()->width() / ColumnCount), itemHeight(this, fontMetrics(), _thumbnailSize));
+	if (cellSize != gridSize())
+		setGridSize(cellSize);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QListView>
+
+// Shows ProfileListModel as radio buttons with thumbnails in two columns.
+// All the items have the same size and only the visible ones are painted, so the cost of the view
+// doesn't depend on the number of profiles. Clicking a profile or pressing Space toggles it.
+class ProfileListView final : public QListView {
+public:
+	static constexpr int ColumnCount = 2;
+
+	explicit ProfileListView(QSize thumbnailSize, QWidget* parent = nullptr);
+
+protected:
+	void resizeEvent(QResizeEvent* event) override;
+
+private:
+	void updateGridSize();
+
+	const QSize _thumbnailSize;
+};
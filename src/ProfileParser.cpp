@@ -1,42 +1,376 @@
 #include "ProfileParser.h"
 
 #include <QFile>
-#include <QTextStream>
-#include <QRegularExpression>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <optional>
+
+namespace {
+
+// Splits a line into whitespace-separated tokens without allocating; ':' is always a token of its own
+class LineTokenizer {
+public:
+	static constexpr size_t MaxTokens = 32;
+
+	explicit LineTokenizer(QStringView line)
+	{
+		for (qsizetype i = 0, n = line.size(); i < n;)
+		{
+			if (line[i].isSpace())
+			{
+				++i;
+				continue;
+			}
+
+			qsizetype end = i + 1;
+			if (line[i] != u':')
+			{
+				while (end < n && !line[end].isSpace() && line[end] != u':')
+					++end;
+			}
+
+			if (_count == MaxTokens)
+			{
+				_overflow = true;
+				return;
+			}
+
+			_tokens[_count++] = line.sliced(i, end - i);
+			i = end;
+		}
+	}
+
+	[[nodiscard]] size_t size() const { return _count; }
+	[[nodiscard]] bool overflow() const { return _overflow; }
+	// Returns an empty view past the end
+	[[nodiscard]] QStringView operator[](size_t index) const { return index < _count ? _tokens[index] : QStringView{}; }
+
+private:
+	std::array<QStringView, MaxTokens> _tokens;
+	size_t _count = 0;
+	bool _overflow = false;
+};
+
+inline bool equalsIgnoreCase(QStringView a, QStringView b)
+{
+	return a.compare(b, Qt::CaseInsensitive) == 0;
+}
+
+// Parses "<number>" or "<number><unit>"
+std::optional<double> parseNumber(QStringView token, QStringView unit)
+{
+	if (!unit.isEmpty() && token.endsWith(unit, Qt::CaseInsensitive))
+		token.chop(unit.size());
+
+	bool ok = false;
+	const double value = token.toDouble(&ok);
+	return ok ? std::optional{ value } : std::nullopt;
+}
+
+struct FilterParameters {
+	std::optional<double> fc;
+	std::optional<double> gain;
+	std::optional<double> q;
+};
+
+// Parses "Fc <number> Hz", "Gain <number> dB" and "Q <number>" in any order, the units are optional
+bool parseFilterParameters(const LineTokenizer& tokens, size_t first, FilterParameters& parameters)
+{
+	for (size_t i = first; i < tokens.size();)
+	{
+		const QStringView key = tokens[i];
+
+		std::optional<double>* value = nullptr;
+		QStringView unit;
+		if (equalsIgnoreCase(key, u"Fc"))
+		{
+			value = &parameters.fc;
+			unit = u"Hz";
+		}
+		else if (equalsIgnoreCase(key, u"Gain"))
+		{
+			value = &parameters.gain;
+			unit = u"dB";
+		}
+		else if (equalsIgnoreCase(key, u"Q"))
+			value = &parameters.q;
+		else
+			return false;
+
+		*value = parseNumber(tokens[i + 1], unit);
+		if (!value->has_value())
+			return false;
+
+		i += 2;
+		if (!unit.isEmpty() && equalsIgnoreCase(tokens[i], unit))
+			++i;
+	}
+
+	return true;
+}
+
+// "Channel: ...", a commented-out one is just a comment
+bool isChannelLine(const LineTokenizer& tokens)
+{
+	return equalsIgnoreCase(tokens[0], u"Channel") && equalsIgnoreCase(tokens[1], u":");
+}
+
+using FilterFactory = std::optional<Filter> (*)(const FilterParameters& parameters, bool enabled);
+
+struct FilterGrammar {
+	QStringView type;
+	FilterFactory create;
+};
+
+// Checks which parameters the type takes; WithQToken is for the "LPQ" / "HPQ" tokens, which require the Q
+template<BiquadType Type, bool WithQToken = false>
+std::optional<Filter> createBiquad(const FilterParameters& p, bool enabled)
+{
+	constexpr BiquadTraits traits = biquadTraits(Type);
+	const bool qRequired = traits.q == QUsage::Required || WithQToken;
+	if (!p.fc || p.gain.has_value() != traits.hasGain || (traits.q == QUsage::None && p.q) || (qRequired && !p.q))
+		return std::nullopt;
+
+	return BiquadFilter<Type>{ *p.fc, p.gain.value_or(0.0), p.q.value_or(traits.defaultQ), enabled };
+}
+
+// Filter types that can be edited, keyed by the E-APO type token. Any other type becomes an UnsupportedFilter.
+constexpr std::array filterGrammars{
+	FilterGrammar{ u"PK", &createBiquad<BiquadType::Peaking> },
+	FilterGrammar{ u"LS", &createBiquad<BiquadType::LowShelf> },
+	FilterGrammar{ u"HS", &createBiquad<BiquadType::HighShelf> },
+	FilterGrammar{ u"LSC", &createBiquad<BiquadType::LowShelfCenter> },
+	FilterGrammar{ u"HSC", &createBiquad<BiquadType::HighShelfCenter> },
+	FilterGrammar{ u"LP", &createBiquad<BiquadType::LowPass> },
+	FilterGrammar{ u"LPQ", &createBiquad<BiquadType::LowPass, true> },
+	FilterGrammar{ u"HP", &createBiquad<BiquadType::HighPass> },
+	FilterGrammar{ u"HPQ", &createBiquad<BiquadType::HighPass, true> },
+	FilterGrammar{ u"BP", &createBiquad<BiquadType::BandPass> },
+	FilterGrammar{ u"NO", &createBiquad<BiquadType::Notch> },
+	FilterGrammar{ u"AP", &createBiquad<BiquadType::AllPass> },
+};
+
+// "Include: <file>", kept as it is, the included filters are resolved by IncludeResolver
+bool isIncludeLine(QStringView line)
+{
+	const LineTokenizer tokens(line);
+	return equalsIgnoreCase(tokens[0], u"Include") && equalsIgnoreCase(tokens[1], u":");
+}
+
+// Serializes a new or edited filter, keeping the "Filter N:" numbering of the line it came from, if any
+QString filterLine(const Filter& filter, QStringView originalLine)
+{
+	const IFilter& f = asIFilter(filter);
+	QString line = f.toConfigLine();
+
+	QStringView original = originalLine.trimmed();
+	if (original.startsWith(u'#'))
+		original = original.sliced(1).trimmed();
+
+	const qsizetype colon = original.indexOf(u':');
+	if (colon > 0 && line.startsWith(u"Filter:") && original.startsWith(u"Filter", Qt::CaseInsensitive))
+		line.replace(0, 6, original.first(colon).trimmed().toString()); // "Filter" -> "Filter N"
+
+	// Add comment prefix if filter is disabled
+	if (!f.isEnabled())
+		line = "# " + line;
+
+	return line;
+}
+
+} // namespace
+
+void ProfileData::appendFilter(Filter filter)
+{
+	filters.push_back(std::move(filter));
+	_filterOrigins.push_back(-1);
+}
+
+void ProfileData::removeFilter(size_t index)
+{
+	filters.erase(filters.begin() + static_cast<ptrdiff_t>(index));
+	_filterOrigins.erase(_filterOrigins.begin() + static_cast<ptrdiff_t>(index));
+}
+
+bool ProfileData::isModified() const
+{
+	if (filters.size() != _originalFilters.size())
+		return true;
+
+	for (size_t i = 0; i < filters.size(); ++i)
+	{
+		if (_filterOrigins[i] != static_cast<int>(i) || filters[i] != _originalFilters[i])
+			return true;
+	}
+
+	return false;
+}
+
+QString ProfileData::toText() const
+{
+	assert(_filterOrigins.size() == filters.size());
+
+	// Where each of the original filters is now, -1 if it has been removed
+	std::vector<int> currentIndices(_originalFilters.size(), -1);
+	for (size_t i = 0; i < filters.size(); ++i)
+	{
+		if (_filterOrigins[i] >= 0)
+			currentIndices[static_cast<size_t>(_filterOrigins[i])] = static_cast<int>(i);
+	}
+
+	const QStringView source = _source;
+	QString text;
+	text.reserve(source.size() + 64);
+	text += source.first(_lines.empty() ? source.size() : _lines.front().offset); // Byte order mark
+
+	for (const SourceLine& line : _lines)
+	{
+		const QStringView original = source.sliced(line.offset, line.length);
+		const QStringView originalLineBreak = source.sliced(line.offset + line.length, line.lineBreakLength);
+
+		if (line.filter >= 0)
+		{
+			const int index = currentIndices[static_cast<size_t>(line.filter)];
+			if (index < 0)
+				continue; // The filter has been removed
+
+			const Filter& filter = filters[static_cast<size_t>(index)];
+			if (filter != _originalFilters[static_cast<size_t>(line.filter)])
+			{
+				text += filterLine(filter, original);
+				text += originalLineBreak;
+				continue;
+			}
+		}
+
+		// Untouched line
+		text += original;
+		text += originalLineBreak;
+	}
+
+	// Added filters go to the end
+	for (size_t i = 0; i < filters.size(); ++i)
+	{
+		if (_filterOrigins[i] >= 0)
+			continue;
+
+		if (!text.isEmpty() && !text.endsWith(u'\n'))
+			text += lineBreak();
+
+		text += filterLine(filters[i], {});
+		text += lineBreak();
+	}
+
+	return text;
+}
+
+QStringView ProfileData::lineBreak() const
+{
+	// Follow the source's convention, E-APO being a Windows application the default is CRLF
+	for (const SourceLine& line : _lines)
+	{
+		if (line.lineBreakLength > 0)
+			return QStringView{ _source }.sliced(line.offset + line.length, line.lineBreakLength);
+	}
+
+	return u"\r\n";
+}
+
+ChannelFilterList ProfileData::channelFilters() const
+{
+	ChannelFilterList list;
+	if (!_hasChannelLines)
+		return list;
+
+	list.namedChannels = _namedChannels;
+	list.filters.reserve(filters.size());
+	list.channels.reserve(filters.size());
+	for (size_t i = 0; i < filters.size(); ++i)
+		list.append(filters[i], _filterOrigins[i] >= 0 ? _originalChannels[static_cast<size_t>(_filterOrigins[i])] : _endChannels);
+
+	return list;
+}
 
 std::expected<ProfileData, QString> ProfileParser::parseProfile(const QString& filePath)
 {
 	QFile file(filePath);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	if (!file.open(QIODevice::ReadOnly))
 		return std::unexpected("Failed to open file for reading: " + filePath);
 
-	QTextStream in(&file);
-	in.setEncoding(QStringConverter::Utf8);
+	// Decoded in one go, the lines are then only viewed into
+	QString text = QString::fromUtf8(file.readAll());
+	if (file.error() != QFile::NoError)
+		return std::unexpected("Error reading file: " + file.errorString());
 
+	return parseProfileText(std::move(text));
+}
+
+std::expected<ProfileData, QString> ProfileParser::parseProfileText(QString text)
+{
 	ProfileData data;
-	QString line;
+	data._source = std::move(text);
+
+	const QStringView source = data._source;
+	data.filters.reserve(static_cast<size_t>(source.count(u'\n')) + 1);
 	bool hasEnabledUnsupportedFilter = false;
 
-	while (in.readLineInto(&line))
+	for (qsizetype start = source.startsWith(QChar::ByteOrderMark) ? 1 : 0; start < source.size();)
 	{
-		line = line.trimmed();
-		if (line.isEmpty())
-			continue;
+		const qsizetype newline = source.indexOf(u'\n', start);
+		const qsizetype end = newline < 0 ? source.size() : newline;
 
-		auto filterResult = parseLine(line);
-		if (!filterResult.has_value())
-			return std::unexpected(filterResult.error());
+		ProfileData::SourceLine sourceLine;
+		sourceLine.offset = start;
+		sourceLine.length = end - start;
+		sourceLine.lineBreakLength = newline < 0 ? 0 : 1;
+		if (sourceLine.length > 0 && source[end - 1] == u'\r')
+		{
+			--sourceLine.length;
+			++sourceLine.lineBreakLength;
+		}
+
+		start = newline < 0 ? source.size() : newline + 1;
 
-		auto& filter = filterResult.value();
-		
-		// Check if it's an enabled unsupported filter
-		if (auto* unsupported = dynamic_cast<UnsupportedFilter*>(filter.get()))
+		const QStringView line = source.sliced(sourceLine.offset, sourceLine.length).trimmed();
+		if (line.startsWith(u"Channel", Qt::CaseInsensitive) && isChannelLine(LineTokenizer(line)))
 		{
-			if (unsupported->isEnabled())
-				hasEnabledUnsupportedFilter = true;
+			// Kept as it is, it only scopes the filters below it
+			auto channels = parseChannelLine(line);
+			if (!channels)
+				return std::unexpected(channels.error());
+
+			data._endChannels = *channels;
+			if (!line.endsWith(u"all", Qt::CaseInsensitive))
+				data._namedChannels |= *channels;
+			data._hasChannelLines = true;
 		}
+		else if (!line.isEmpty())
+		{
+			auto filterResult = parseLine(line);
+			if (filterResult.has_value())
+			{
+				auto& filter = filterResult.value();
 
-		data.filters.push_back(std::move(filter));
+				// Check if it's an enabled unsupported filter
+				if (auto* unsupported = std::get_if<UnsupportedFilter>(&filter))
+				{
+					if (unsupported->isEnabled())
+						hasEnabledUnsupportedFilter = true;
+				}
+
+				sourceLine.filter = static_cast<int>(data._originalFilters.size());
+				data._filterOrigins.push_back(sourceLine.filter);
+				data._originalFilters.push_back(filter);
+				data._originalChannels.push_back(data._endChannels);
+				data.filters.push_back(std::move(filter));
+			}
+			else if (!line.startsWith(u'#') && !isIncludeLine(line)) // A commented-out line that isn't a filter is just a comment
+				return std::unexpected(filterResult.error());
+		}
+
+		data._lines.push_back(sourceLine);
 	}
 
 	if (hasEnabledUnsupportedFilter)
@@ -45,84 +379,138 @@ std::expected<ProfileData, QString> ProfileParser::parseProfile(const QString& f
 	return data;
 }
 
-std::expected<FilterUniquePtr, QString> ProfileParser::parseLine(const QString& line)
+std::expected<Filter, QString> ProfileParser::parseLine(QStringView line)
 {
-	QString trimmedLine = line.trimmed();
-	bool isCommented = trimmedLine.startsWith("#");
-	QString cleanLine = isCommented ? trimmedLine.mid(1).trimmed() : trimmedLine;
+	QStringView cleanLine = line.trimmed();
+	const bool isCommented = cleanLine.startsWith(u'#');
+	if (isCommented)
+		cleanLine = cleanLine.sliced(1).trimmed();
 
-	// Parse Preamp
-	if (cleanLine.startsWith("Preamp:", Qt::CaseInsensitive))
+	const LineTokenizer tokens(cleanLine);
+
+	// Parse Preamp: "Preamp: <gain> dB"
+	if (equalsIgnoreCase(tokens[0], u"Preamp") && equalsIgnoreCase(tokens[1], u":"))
 	{
-		// Extract gain value
-		QRegularExpression re(R"(Preamp:\s*([-+]?\d+\.?\d*)\s*dB)", QRegularExpression::CaseInsensitiveOption);
-		auto match = re.match(cleanLine);
-		if (!match.hasMatch())
-			return std::unexpected("Failed to parse Preamp line: " + line);
-
-		double gain = match.captured(1).toDouble();
-		return std::make_unique<PreampFilter>(gain, !isCommented);
+		const auto gain = parseNumber(tokens[2], u"dB");
+		const size_t expectedTokens = tokens[2].endsWith(u"dB", Qt::CaseInsensitive) ? 3 : 4;
+		if (!gain || tokens.size() != expectedTokens || (expectedTokens == 4 && !equalsIgnoreCase(tokens[3], u"dB")))
+			return std::unexpected("Failed to parse Preamp line: " + line.toString());
+
+		return PreampFilter{ *gain, !isCommented };
 	}
 
-	// Parse Filter lines
-	if (cleanLine.startsWith("Filter ", Qt::CaseInsensitive))
+	// Parse Filter lines: "Filter[ <number>]: ON|OFF <type> <parameters>"
+	if (equalsIgnoreCase(tokens[0], u"Filter"))
 	{
+		const size_t colon = equalsIgnoreCase(tokens[1], u":") ? 1 : 2;
+		if (!equalsIgnoreCase(tokens[colon], u":"))
+			return std::unexpected("Unknown line format: " + line.toString());
+
 		// Check if it's ON or OFF
-		bool enabled = cleanLine.contains(" ON ", Qt::CaseInsensitive);
-		bool disabled = cleanLine.contains(" OFF ", Qt::CaseInsensitive);
-		
-		if (!enabled && !disabled)
-			return std::unexpected("Filter line missing ON/OFF: " + line);
+		const QStringView state = tokens[colon + 1];
+		const bool on = equalsIgnoreCase(state, u"ON");
+		if (!on && !equalsIgnoreCase(state, u"OFF"))
+			return std::unexpected("Filter line missing ON/OFF: " + line.toString());
+
+		// A commented-out filter is disabled regardless of its ON/OFF state
+		const bool enabled = on && !isCommented;
 
 		// Check filter type
-		if (cleanLine.contains(" PK ", Qt::CaseInsensitive))
-		{
-			// Parse peaking filter: Filter: ON PK Fc 160.7 Hz Gain -2 dB Q 3.92
-			QRegularExpression re(
-				R"(Filter [0-9]*:\s*(ON|OFF)\s+PK\s+Fc\s+([-+]?\d+\.?\d*)\s*Hz\s+Gain\s+([-+]?\d+\.?\d*)\s*dB\s+Q\s+([-+]?\d+\.?\d*))",
-				QRegularExpression::CaseInsensitiveOption
-			);
-			auto match = re.match(cleanLine);
-			if (!match.hasMatch())
-				return std::unexpected("Failed to parse PK filter line: " + line);
-
-			double fc = match.captured(2).toDouble();
-			double gain = match.captured(3).toDouble();
-			double q = match.captured(4).toDouble();
-
-			return std::make_unique<PeakingFilter>(fc, gain, q, enabled);
-		}
-		else
+		const QStringView type = tokens[colon + 2];
+
+		// The shelves with a slope in dB per octave ("LS 6dB", "HSC 12dB") are first-order or
+		// differently parameterized, they are preserved as they are
+		if (tokens[colon + 3].endsWith(u"dB", Qt::CaseInsensitive))
+			return UnsupportedFilter{ cleanLine.toString(), enabled };
+
+		for (const FilterGrammar& grammar : filterGrammars)
 		{
-			// Unsupported filter type - preserve as-is
-			return std::make_unique<UnsupportedFilter>(cleanLine, enabled);
+			if (!equalsIgnoreCase(type, grammar.type))
+				continue;
+
+			FilterParameters parameters;
+			std::optional<Filter> filter;
+			if (!tokens.overflow() && parseFilterParameters(tokens, colon + 3, parameters))
+				filter = grammar.create(parameters, enabled);
+
+			if (!filter)
+			{
+				// A malformed PK line is an error, the other types have forms the editor doesn't model
+				// ("BW Oct" bandwidths, a Gain on BP, a Q on LS...) and are preserved as they are
+				if (grammar.type != u"PK")
+					return UnsupportedFilter{ cleanLine.toString(), enabled };
+
+				return std::unexpected("Failed to parse " + grammar.type.toString() + " filter line: " + line.toString());
+			}
+
+			return std::move(*filter);
 		}
+
+		// Unsupported filter type - preserve as-is
+		return UnsupportedFilter{ cleanLine.toString(), enabled };
 	}
 
 	// Unknown line format
-	return std::unexpected("Unknown line format: " + line);
+	return std::unexpected("Unknown line format: " + line.toString());
 }
 
-std::expected<void, QString> ProfileParser::saveProfile(const QString& filePath, const std::vector<FilterUniquePtr>& filters)
+std::expected<ChannelMask, QString> ProfileParser::parseChannelLine(QStringView line)
 {
-	QFile file(filePath);
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-		return std::unexpected("Failed to open file for writing: " + filePath);
+	const LineTokenizer tokens(line.trimmed());
+	if (!isChannelLine(tokens) || tokens.size() < 3 || tokens.overflow())
+		return std::unexpected("Failed to parse Channel line: " + line.toString());
 
-	QTextStream out(&file);
-	out.setEncoding(QStringConverter::Utf8);
+	if (tokens.size() == 3 && equalsIgnoreCase(tokens[2], u"all"))
+		return AllChannels;
 
-	for (const auto& filter : filters)
+	ChannelMask mask = 0;
+	for (size_t i = 2; i < tokens.size(); ++i)
 	{
-		QString line = filter->toConfigLine();
-		
-		// Add comment prefix if filter is disabled
-		if (!filter->isEnabled())
-			line = "# " + line;
+		const QStringView token = tokens[i];
+		const auto name = std::find_if(ChannelNames.begin(), ChannelNames.end(), [&](QStringView n) { return equalsIgnoreCase(n, token); });
 
-		out << line << "\r\n";
+		bool isNumber = false;
+		const int number = token.toInt(&isNumber);
+		if (name != ChannelNames.end())
+			mask |= static_cast<ChannelMask>(1u << (name - ChannelNames.begin()));
+		else if (isNumber && number >= 1 && number <= static_cast<int>(MaxChannels))
+			mask |= static_cast<ChannelMask>(1u << (number - 1));
+		else
+			return std::unexpected("Unknown channel \"" + token.toString() + "\" in: " + line.toString());
 	}
 
+	return mask;
+}
+
+std::expected<void, QString> ProfileParser::saveProfile(const QString& filePath, const FilterList& filters)
+{
+	QString text;
+	for (const Filter& filter : filters)
+	{
+		text += filterLine(filter, {});
+		text += "\r\n";
+	}
+
+	return writeFile(filePath, text);
+}
+
+std::expected<void, QString> ProfileParser::saveProfile(const QString& filePath, const ProfileData& profile)
+{
+	if (!profile.isModified())
+		return {}; // Avoid touching the file for nothing
+
+	return writeFile(filePath, profile.toText());
+}
+
+std::expected<void, QString> ProfileParser::writeFile(const QString& filePath, const QString& text)
+{
+	// Binary mode, the line breaks are already in the text
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly))
+		return std::unexpected("Failed to open file for writing: " + filePath);
+
+	file.write(text.toUtf8());
+
 	file.close();
 	if (file.error() != QFile::NoError)
 		return std::unexpected("Error writing to file: " + file.errorString());
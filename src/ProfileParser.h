@@ -3,12 +3,49 @@
 #include "Filter.h"
 
 #include <QString>
+#include <QStringView>
 
 #include <expected>
 #include <vector>
 
+// A parsed profile that remembers its source text, so that saving only rewrites the lines of the filters that
+// have actually been edited and writes everything else (comments, numbering, formatting) back byte-for-byte.
+// The filters can be edited in place; adding and removing must go through appendFilter() / removeFilter().
 struct ProfileData {
-	std::vector<FilterUniquePtr> filters;
+	FilterList filters;
+
+	void appendFilter(Filter filter);
+	void removeFilter(size_t index);
+
+	[[nodiscard]] bool isModified() const;
+	// The profile text with the edits applied
+	[[nodiscard]] QString toText() const;
+	// The filters with the channels they apply to, added filters take the selection in effect at the end of the file.
+	// Empty if the profile has no "Channel:" lines.
+	[[nodiscard]] ChannelFilterList channelFilters() const;
+
+private:
+	friend class ProfileParser;
+
+	// A line of the source text
+	struct SourceLine {
+		qsizetype offset = 0;
+		qsizetype length = 0; // Without the line break
+		qsizetype lineBreakLength = 0;
+		int filter = -1; // Index into _originalFilters, -1 for blank and comment lines
+	};
+
+	[[nodiscard]] QStringView lineBreak() const;
+
+	QString _source;
+	std::vector<SourceLine> _lines;
+	FilterList _originalFilters; // As parsed from the source
+	std::vector<int> _filterOrigins; // For each filter, its index in _originalFilters or -1 if it was added
+
+	std::vector<ChannelMask> _originalChannels; // Parallel to _originalFilters
+	ChannelMask _endChannels = AllChannels;
+	ChannelMask _namedChannels = 0;
+	bool _hasChannelLines = false;
 };
 
 class ProfileParser {
@@ -16,10 +53,18 @@ public:
 	// Parse a profile file and return filters
 	// Returns error if enabled unsupported filters are found
 	static std::expected<ProfileData, QString> parseProfile(const QString& filePath);
+	static std::expected<ProfileData, QString> parseProfileText(QString text);
 
 	// Write filters back to profile file
-	static std::expected<void, QString> saveProfile(const QString& filePath, const std::vector<FilterUniquePtr>& filters);
+	static std::expected<void, QString> saveProfile(const QString& filePath, const FilterList& filters);
+	// Write the edited profile back to its file; the file is not touched if nothing has changed
+	static std::expected<void, QString> saveProfile(const QString& filePath, const ProfileData& profile);
+
+	// Parses a single Preamp or Filter line, a leading '#' makes the filter disabled
+	static std::expected<Filter, QString> parseLine(QStringView line);
+	// Parses "Channel: <L|R|C|SUB|RL|RR|SL|SR|1-8>..." or "Channel: all"
+	static std::expected<ChannelMask, QString> parseChannelLine(QStringView line);
 
 private:
-	static std::expected<FilterUniquePtr, QString> parseLine(const QString& line);
+	static std::expected<void, QString> writeFile(const QString& filePath, const QString& text);
 };
@@ -0,0 +1,117 @@
+#include "ProfileScanner.h"
+#include "ParallelFor.h"
+#include "ProfileCache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+namespace {
+
+// Summarizes a profile using the cache when possible. Returns the new cache entry if the cached one was missing or stale.
+std::optional<ProfileCache::Entry> scanProfile(const QString& filePath, const ProfileCache* cache, ProfileSummary& summary)
+{
+	const QFileInfo info(filePath);
+	ProfileCache::Entry entry;
+	entry.size = info.size();
+	entry.modified = info.lastModified().toMSecsSinceEpoch();
+
+	const std::optional<ProfileCache::Entry> cached = cache ? cache->find(filePath) : std::nullopt;
+	if (cached && cached->size == entry.size && cached->modified == entry.modified)
+	{
+		summary = cached->summary;
+		summary.hash = cached->hash;
+		summary.filters = cached->filters;
+		return std::nullopt;
+	}
+
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		summary.error = "Failed to open file: " + filePath;
+		return std::nullopt;
+	}
+
+	const QByteArray contents = file.readAll();
+	entry.hash = ProfileCache::contentHash(contents);
+
+	// Touched but not changed, only the timestamp needs updating
+	if (cached && cached->hash == entry.hash)
+	{
+		entry.summary = cached->summary;
+		entry.filters = cached->filters;
+		summary = entry.summary;
+		summary.hash = entry.hash;
+		summary.filters = entry.filters;
+		return entry;
+	}
+
+	if (auto profile = ProfileParser::parseProfileText(QString::fromUtf8(contents)); profile.has_value())
+	{
+		entry.summary = ProfileScanner::summarize(profile.value(), ProfileScanner::summaryGrid());
+		entry.filters = std::move(profile.value().filters);
+	}
+	else
+	{
+		entry.summary.error = profile.error();
+	}
+
+	summary = entry.summary;
+	summary.hash = entry.hash;
+	summary.filters = entry.filters;
+	return entry;
+}
+
+} // namespace
+
+ProfileIndex ProfileScanner::scan(const QString& configFolder, const QStringList& fileNames, ProfileCache* cache)
+{
+	const QDir folder(configFolder);
+
+	std::vector<ProfileSummary> summaries(static_cast<size_t>(fileNames.size()));
+	std::vector<std::optional<ProfileCache::Entry>> updatedEntries(summaries.size());
+	parallelFor(summaries.size(), [&](size_t i) {
+		const QString filePath = folder.filePath(fileNames[static_cast<qsizetype>(i)]);
+		updatedEntries[i] = scanProfile(filePath, cache, summaries[i]);
+	});
+
+	ProfileIndex index;
+	index.reserve(fileNames.size());
+	for (size_t i = 0; i < summaries.size(); ++i)
+	{
+		if (cache && updatedEntries[i])
+			cache->insert(folder.filePath(fileNames[static_cast<qsizetype>(i)]), std::move(*updatedEntries[i]));
+
+		index.insert(fileNames[static_cast<qsizetype>(i)], std::move(summaries[i]));
+	}
+
+	return index;
+}
+
+ProfileSummary ProfileScanner::summarize(const ProfileData& profile, const FrequencyGrid& grid)
+{
+	ProfileSummary summary;
+	summary.filterCount = static_cast<size_t>(std::count_if(profile.filters.begin(), profile.filters.end(), [](const Filter& filter) {
+		return asIFilter(filter).isEnabled();
+	}));
+
+	const std::vector<double> response = calculateFrequencyResponse(profile.filters, grid);
+	const auto [minIt, maxIt] = std::minmax_element(response.begin(), response.end());
+	summary.minGainDb = *minIt;
+	summary.maxGainDb = *maxIt;
+	summary.requiredPreampDb = -std::max(0.0, summary.maxGainDb);
+
+	return summary;
+}
+
+const FrequencyGrid& ProfileScanner::summaryGrid()
+{
+	// Dense enough to catch the peaks of Q = 10 filters within a fraction of a dB, the full audible range
+	static const FrequencyGrid grid = FrequencyGrid::logarithmic(1024, 20.0, 20000.0);
+	return grid;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "FrequencyResponse.h"
+#include "ProfileParser.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+struct ProfileSummary {
+	size_t filterCount = 0; // Enabled filters, preamps included
+	double maxGainDb = 0.0; // Extremes of the combined response
+	double minGainDb = 0.0;
+	double requiredPreampDb = 0.0; // Preamp gain that keeps the response peak at 0 dB, 0 if it doesn't go above 0 dB
+	QString error; // Empty if the profile has been parsed successfully
+	QByteArray hash; // Of the file contents, identifies this version of the profile
+	FilterList filters; // As parsed or cached by the scan, for the thumbnail
+};
+
+// Keyed by the profile file name as it appears in config.txt
+using ProfileIndex = QHash<QString, ProfileSummary>;
+
+class ProfileCache;
+
+class ProfileScanner {
+public:
+	// Parses and summarizes the profiles in parallel on all the available cores.
+	// With a cache, only the profiles that have changed since they were cached are parsed, and the cache is updated with them.
+	[[nodiscard]] static ProfileIndex scan(const QString& configFolder, const QStringList& fileNames, ProfileCache* cache = nullptr);
+
+	[[nodiscard]] static ProfileSummary summarize(const ProfileData& profile, const FrequencyGrid& grid);
+	[[nodiscard]] static const FrequencyGrid& summaryGrid();
+};
@@ -0,0 +1,109 @@
+#include "ProfileThumbnails.h"
+#include "FrequencyResponse.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <algorithm>
+
+namespace {
+
+// Enough for a few hundred thumbnails at 2x scaling
+inline constexpr qsizetype MaxCacheBytes = 16 * 1024 * 1024;
+
+} // namespace
+
+ProfileThumbnails::ProfileThumbnails(std::function<void(const QByteArray& hash)> onReady) :
+	_onReady(std::move(onReady))
+{
+	_cache.setMaxCost(MaxCacheBytes);
+}
+
+ProfileThumbnails::~ProfileThumbnails()
+{
+	_renderPool.clear();
+	_renderPool.waitForDone();
+}
+
+QPixmap ProfileThumbnails::thumbnail(const FilterList& filters, const QByteArray& hash)
+{
+	if (const QPixmap* cached = _cache.object(hash))
+		return *cached;
+
+	if (hash.isEmpty() || _pending.contains(hash))
+		return {};
+
+	_pending.insert(hash);
+	_renderPool.start([this, filters, hash, size{ _size }, devicePixelRatio{ _devicePixelRatio }, generation{ _generation }] {
+		QImage image = render(filters, size, devicePixelRatio);
+
+		// QPixmap can only be created on the GUI thread
+		QMetaObject::invokeMethod(&_context, [this, hash, generation, image{ std::move(image) }] {
+			if (generation != _generation)
+				return;
+
+			_pending.remove(hash);
+			QPixmap* pixmap = new QPixmap(QPixmap::fromImage(image));
+			_cache.insert(hash, pixmap, std::max<qsizetype>(1, image.sizeInBytes()));
+			_onReady(hash);
+		}, Qt::QueuedConnection);
+	});
+
+	return {};
+}
+
+void ProfileThumbnails::setSize(QSize size, qreal devicePixelRatio)
+{
+	if (size == _size && devicePixelRatio == _devicePixelRatio)
+		return;
+
+	_size = size;
+	_devicePixelRatio = devicePixelRatio;
+
+	++_generation;
+	_renderPool.clear();
+	_pending.clear();
+	_cache.clear();
+}
+
+QImage ProfileThumbnails::render(const FilterList& filters, QSize size, qreal devicePixelRatio)
+{
+	const QSize pixelSize = size * devicePixelRatio;
+	if (pixelSize.isEmpty())
+		return {};
+
+	// One point per physical pixel column
+	const FrequencyGrid grid = FrequencyGrid::logarithmic(static_cast<size_t>(pixelSize.width()), 20.0, 20000.0);
+	const std::vector<double> response = calculateFrequencyResponse(filters, grid);
+
+	QImage image(pixelSize, QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(devicePixelRatio);
+	image.fill(Qt::transparent);
+
+	const double width = size.width();
+	const double height = size.height();
+	const auto dbToY = [height](double db) {
+		return (MaxDb - std::clamp(db, -MaxDb, MaxDb)) / (2.0 * MaxDb) * (height - 1.0) + 0.5;
+	};
+
+	QPainterPath curve;
+	for (size_t i = 0; i < response.size(); ++i)
+	{
+		const double x = response.size() > 1 ? width * static_cast<double>(i) / static_cast<double>(response.size() - 1) : 0.0;
+		if (i == 0)
+			curve.moveTo(x, dbToY(response[i]));
+		else
+			curve.lineTo(x, dbToY(response[i]));
+	}
+
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+
+	painter.setPen(QPen(Qt::lightGray, 1));
+	painter.drawLine(QPointF(0.0, dbToY(0.0)), QPointF(width, dbToY(0.0)));
+
+	painter.setPen(QPen(QColor(0, 120, 215), 1.5));
+	painter.drawPath(curve);
+
+	return image;
+}
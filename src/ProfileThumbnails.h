@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Filter.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+
+#include <functional>
+
+// Small frequency response sparklines of the profiles, rendered on a thread pool and kept in an LRU cache
+// keyed by the hash of the profile contents. Must be used from the GUI thread only.
+class ProfileThumbnails final {
+public:
+	static constexpr QSize DefaultSize{ 64, 20 };
+	// The vertical range of the thumbnails is +-MaxDb, larger gains are clipped
+	static constexpr double MaxDb = 12.0;
+
+	// onReady is called with the hash of every thumbnail that has been rendered in the background
+	explicit ProfileThumbnails(std::function<void(const QByteArray& hash)> onReady);
+	~ProfileThumbnails();
+
+	// Returns the cached thumbnail. If it isn't cached yet, returns a null pixmap and starts rendering the filters,
+	// which are the ones the scan has parsed or found in the profile cache.
+	[[nodiscard]] QPixmap thumbnail(const FilterList& filters, const QByteArray& hash);
+
+	[[nodiscard]] QSize size() const { return _size; }
+	// Drops all the cached thumbnails
+	void setSize(QSize size, qreal devicePixelRatio);
+
+	// Thread-safe
+	[[nodiscard]] static QImage render(const FilterList& filters, QSize size, qreal devicePixelRatio);
+
+private:
+	const std::function<void(const QByteArray& hash)> _onReady;
+
+	QSize _size = DefaultSize;
+	qreal _devicePixelRatio = 1.0;
+
+	QCache<QByteArray, QPixmap> _cache; // The cost is the pixmap size in bytes
+	QSet<QByteArray> _pending;
+	uint64_t _generation = 0; // Thumbnails rendered before the last size change are discarded
+
+	QObject _context; // Delivers the rendered thumbnails to the GUI thread
+	QThreadPool _renderPool;
+};
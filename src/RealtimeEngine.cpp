@@ -0,0 +1,147 @@
+#include "RealtimeEngine.h"
+#include "FlushDenormals.h"
+#include "FrequencyResponse.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Transposed direct form II, the coefficients are shared by all the channels of the frame
+template<typename Section>
+inline void filterFrame(const Section& s, double* frame, double* z1, double* z2, size_t channelCount)
+{
+	for (size_t c = 0; c < channelCount; ++c)
+	{
+		const double x = frame[c];
+		const double y = s.b0 * x + z1[c];
+		z1[c] = s.b1 * x - s.a1 * y + z2[c];
+		z2[c] = s.b2 * x - s.a2 * y;
+		frame[c] = y;
+	}
+}
+
+} // namespace
+
+RealtimeEngine::RealtimeEngine(double sampleRate, size_t channelCount, size_t maxFilters) :
+	_sampleRate(sampleRate),
+	_channelCount(channelCount),
+	_sent(maxFilters),
+	_current(maxFilters),
+	_target(maxFilters),
+	_ramping(maxFilters, false),
+	_state(maxFilters * 2 * channelCount, 0.0)
+{
+}
+
+bool RealtimeEngine::setFilters(const FilterList& filters)
+{
+	for (size_t i = 0; i < _sent.size(); ++i)
+	{
+		const Section target = i < filters.size() ? makeSection(filters[i]) : Section{};
+		if (target == _sent[i])
+			continue;
+
+		if (!_updates.push({ static_cast<uint32_t>(i), target }))
+			return false;
+
+		_sent[i] = target;
+	}
+
+	return filters.size() <= _sent.size();
+}
+
+RealtimeEngine::TimingStats RealtimeEngine::timingStats() const
+{
+	TimingStats stats;
+	for (size_t b = 0; b < HistogramBuckets; ++b)
+	{
+		stats.histogram[b] = _histogram[b].load(std::memory_order_relaxed);
+		stats.blockCount += stats.histogram[b];
+	}
+	stats.worstNanoseconds = _worstNanoseconds.load(std::memory_order_relaxed);
+
+	return stats;
+}
+
+void RealtimeEngine::process(double* samples, size_t frameCount)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const FlushDenormals flushDenormals;
+
+	Update update;
+	while (_updates.pop(update))
+	{
+		_target[update.index] = update.target;
+		_ramping[update.index] = true;
+		_activeCount = std::max(_activeCount, size_t{ update.index } + 1);
+	}
+
+	const size_t channels = _channelCount;
+	const double rampStep = frameCount > 0 ? 1.0 / static_cast<double>(frameCount) : 0.0;
+	for (size_t k = 0; k < _activeCount; ++k)
+	{
+		Section& current = _current[k];
+		double* z1 = _state.data() + k * 2 * channels;
+		double* z2 = z1 + channels;
+
+		if (_ramping[k])
+		{
+			// The coefficients move by the same amount every frame and reach the target on the last one
+			const Section& target = _target[k];
+			const Section step{ (target.b0 - current.b0) * rampStep, (target.b1 - current.b1) * rampStep, (target.b2 - current.b2) * rampStep,
+				(target.a1 - current.a1) * rampStep, (target.a2 - current.a2) * rampStep };
+
+			Section coefficients = current;
+			for (size_t i = 0; i < frameCount; ++i)
+			{
+				coefficients.b0 += step.b0;
+				coefficients.b1 += step.b1;
+				coefficients.b2 += step.b2;
+				coefficients.a1 += step.a1;
+				coefficients.a2 += step.a2;
+				filterFrame(coefficients, samples + i * channels, z1, z2, channels);
+			}
+
+			current = target;
+			_ramping[k] = false;
+
+			// Pass-through sections are skipped, their state would otherwise be stale when they come back
+			if (current == Section{})
+				std::fill(z1, z2 + channels, 0.0);
+		}
+		else if (current != Section{})
+		{
+			for (size_t i = 0; i < frameCount; ++i)
+				filterFrame(current, samples + i * channels, z1, z2, channels);
+		}
+	}
+
+	while (_activeCount > 0 && !_ramping[_activeCount - 1] && _current[_activeCount - 1] == Section{})
+		--_activeCount;
+
+	recordTiming(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+}
+
+RealtimeEngine::Section RealtimeEngine::makeSection(const Filter& filter) const
+{
+	const FilterBank bank = FilterBank::fromFilter(filter, _sampleRate);
+	const double gain = std::pow(10.0, bank.gainDb / 20.0);
+	if (bank.size() == 0)
+		return { gain, 0.0, 0.0, 0.0, 0.0 };
+
+	const double a0 = bank.a0[0];
+	return { gain * bank.b0[0] / a0, gain * bank.b1[0] / a0, gain * bank.b2[0] / a0, bank.a1[0] / a0, bank.a2[0] / a0 };
+}
+
+void RealtimeEngine::recordTiming(uint64_t nanoseconds)
+{
+	const size_t bucket = std::min<size_t>(std::bit_width(nanoseconds / 1000), HistogramBuckets - 1);
+	_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	// Only the audio thread writes it
+	if (nanoseconds > _worstNanoseconds.load(std::memory_order_relaxed))
+		_worstNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Filter.h"
+#include "SpscQueue.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// An in-process stand-in for what Equalizer APO does with a filter list, to check that live edits are glitch-free
+// and to measure the worst-case cost of an audio callback.
+// Every filter of the list gets its own section (disabled and unsupported filters pass through, preamps are
+// gain-only sections), so editing a filter only ever changes its own section. The control thread sends the
+// changed sections through a lock-free queue, and the audio thread picks them up at the start of a block and
+// ramps their coefficients linearly over the block, without locking or allocating.
+class RealtimeEngine final {
+public:
+	static constexpr size_t HistogramBuckets = 24;
+
+	struct TimingStats {
+		// Bucket 0 counts the blocks that took less than 1 us, bucket b the ones that took [2^(b-1), 2^b) us
+		std::array<uint64_t, HistogramBuckets> histogram{};
+		uint64_t blockCount = 0;
+		uint64_t worstNanoseconds = 0;
+	};
+
+	RealtimeEngine(double sampleRate, size_t channelCount, size_t maxFilters = 256);
+
+	// Control thread. Sends the sections of the filters that have changed since the last call. Returns false if
+	// the list is longer than maxFilters or the queue is full; calling again later sends what is still missing.
+	bool setFilters(const FilterList& filters);
+	// Any thread
+	[[nodiscard]] TimingStats timingStats() const;
+
+	// Audio thread. Filters interleaved frames in place.
+	void process(double* samples, size_t frameCount);
+
+private:
+	// Normalized by a0, the default one passes the input through
+	struct Section {
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+
+		bool operator==(const Section&) const = default;
+	};
+
+	struct Update {
+		uint32_t index = 0;
+		Section target;
+	};
+
+	[[nodiscard]] Section makeSection(const Filter& filter) const;
+	void recordTiming(uint64_t nanoseconds);
+
+	const double _sampleRate;
+	const size_t _channelCount;
+
+	// Control thread
+	std::vector<Section> _sent; // The last section sent for every filter
+
+	SpscQueue<Update, 1024> _updates;
+
+	// Audio thread
+	std::vector<Section> _current;
+	std::vector<Section> _target;
+	std::vector<char> _ramping;
+	std::vector<double> _state; // For every section, z1 of all the channels followed by z2 of all the channels
+	size_t _activeCount = 0; // The sections from this one on pass the input through and aren't ramping
+
+	std::array<std::atomic<uint64_t>, HistogramBuckets> _histogram{};
+	std::atomic<uint64_t> _worstNanoseconds = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // Padded because of alignas, which is the point
+#endif
+
+// Bounded single-producer single-consumer queue. push() must always be called from the same thread and pop()
+// from another one; neither locks or allocates, so either side can be a real-time audio thread.
+template<typename T, size_t Capacity>
+class SpscQueue final {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two");
+
+public:
+	// Returns false if the queue is full
+	bool push(const T& value)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _cachedHead == Capacity)
+		{
+			_cachedHead = _head.load(std::memory_order_acquire);
+			if (tail - _cachedHead == Capacity)
+				return false;
+		}
+
+		_items[tail & (Capacity - 1)] = value;
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty
+	bool pop(T& value)
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _cachedTail)
+		{
+			_cachedTail = _tail.load(std::memory_order_acquire);
+			if (head == _cachedTail)
+				return false;
+		}
+
+		value = _items[head & (Capacity - 1)];
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Each side's index and its cached copy of the other side's index share a cache line,
+	// so that the threads only touch each other's line when the cached index runs out
+	static constexpr size_t CacheLineSize = 64;
+
+	alignas(CacheLineSize) std::atomic<size_t> _head = 0; // Written by the consumer
+	size_t _cachedTail = 0;
+
+	alignas(CacheLineSize) std::atomic<size_t> _tail = 0; // Written by the producer
+	size_t _cachedHead = 0;
+
+	alignas(CacheLineSize) std::array<T, Capacity> _items{};
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
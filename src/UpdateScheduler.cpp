@@ -0,0 +1,56 @@
+#include "UpdateScheduler.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <algorithm>
+#include <cmath>
+
+UpdateScheduler::UpdateScheduler(std::function<void()> updateFunction) :
+	_updateFunction(std::move(updateFunction))
+{
+	_timer.setSingleShot(true);
+	_timer.setTimerType(Qt::PreciseTimer);
+	QObject::connect(&_timer, &QTimer::timeout, [this] { execute(); });
+
+	if (const QScreen* screen = QGuiApplication::primaryScreen(); screen && screen->refreshRate() > 0)
+		_frameIntervalMs = std::max(1, static_cast<int>(std::lround(1000.0 / screen->refreshRate())));
+}
+
+void UpdateScheduler::schedule()
+{
+	if (_timer.isActive())
+	{
+		++_coalescedRequests;
+		return;
+	}
+
+	const qint64 elapsed = _sinceLastUpdate.isValid() ? _sinceLastUpdate.elapsed() : _frameIntervalMs;
+	_timer.start(static_cast<int>(std::max<qint64>(0, _frameIntervalMs - elapsed)));
+}
+
+void UpdateScheduler::cancel()
+{
+	_timer.stop();
+}
+
+void UpdateScheduler::flush()
+{
+	if (!_timer.isActive())
+		return;
+
+	_timer.stop();
+	execute();
+}
+
+void UpdateScheduler::setFrameInterval(int milliseconds)
+{
+	_frameIntervalMs = std::max(1, milliseconds);
+}
+
+void UpdateScheduler::execute()
+{
+	_sinceLastUpdate.start();
+	++_executedUpdates;
+	_updateFunction();
+}
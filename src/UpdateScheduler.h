@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <cstdint>
+#include <functional>
+
+// Coalesces all the update requests made within one display frame into a single call of the update function.
+// The first request after an idle period is executed on the next event loop iteration,
+// the following ones no more often than once per frame interval.
+class UpdateScheduler final {
+public:
+	explicit UpdateScheduler(std::function<void()> updateFunction);
+
+	void schedule();
+	// Drops the pending update, if any
+	void cancel();
+	// Executes the pending update right away, if any
+	void flush();
+
+	// Defaults to the refresh rate of the primary screen
+	void setFrameInterval(int milliseconds);
+
+	[[nodiscard]] uint64_t executedUpdates() const { return _executedUpdates; }
+	[[nodiscard]] uint64_t coalescedRequests() const { return _coalescedRequests; }
+
+private:
+	void execute();
+
+private:
+	const std::function<void()> _updateFunction;
+
+	QTimer _timer;
+	QElapsedTimer _sinceLastUpdate;
+	int _frameIntervalMs = 16;
+
+	uint64_t _executedUpdates = 0;
+	uint64_t _coalescedRequests = 0;
+};
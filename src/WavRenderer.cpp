@@ -0,0 +1,379 @@
+#include "WavRenderer.h"
+#include "BiquadCascade.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <optional>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace {
+
+inline constexpr qint64 BlockFrames = 16384;
+// Blocks in flight between the reading, filtering and writing stages
+inline constexpr size_t BlockCount = 4;
+
+inline constexpr quint16 FormatPcm = 1;
+inline constexpr quint16 FormatFloat = 3;
+inline constexpr quint16 FormatExtensible = 0xFFFE;
+// Chunk sizes that don't fit in 32 bits are stored in the ds64 chunk of RF64 files
+inline constexpr quint32 Rf64Size = 0xFFFFFFFF;
+
+struct WavFormat {
+	bool isFloat = false;
+	int channelCount = 0;
+	int sampleRate = 0;
+	int bitsPerSample = 0;
+	QByteArray fmtChunk; // Written to the output as it is, which keeps the channel mask of extensible files
+
+	qint64 dataOffset = 0;
+	qint64 frameCount = 0;
+
+	[[nodiscard]] qint64 bytesPerFrame() const { return qint64{ channelCount } * bitsPerSample / 8; }
+};
+
+template<typename T>
+T readLittleEndian(const QByteArray& bytes, qsizetype offset)
+{
+	return qFromLittleEndian<T>(bytes.constData() + offset);
+}
+
+template<typename T>
+void appendLittleEndian(QByteArray& bytes, T value)
+{
+	const qsizetype offset = bytes.size();
+	bytes.resize(offset + static_cast<qsizetype>(sizeof(T)));
+	qToLittleEndian<T>(value, bytes.data() + offset);
+}
+
+std::expected<WavFormat, QString> readHeader(QFile& file)
+{
+	const QByteArray riff = file.read(12);
+	const bool isRf64 = riff.startsWith("RF64");
+	if (riff.size() < 12 || !(riff.startsWith("RIFF") || isRf64) || riff.mid(8, 4) != "WAVE")
+		return std::unexpected("Not a WAV file: " + file.fileName());
+
+	WavFormat format;
+	std::optional<quint64> rf64DataSize;
+	std::optional<quint64> dataSize;
+	quint16 formatTag = 0;
+
+	while (!dataSize)
+	{
+		const QByteArray chunkHeader = file.read(8);
+		if (chunkHeader.size() < 8)
+			break;
+
+		const QByteArray id = chunkHeader.first(4);
+		const quint32 size = readLittleEndian<quint32>(chunkHeader, 4);
+		const qint64 start = file.pos();
+
+		if (id == "ds64" && size >= 16)
+		{
+			if (const QByteArray ds64 = file.read(16); ds64.size() == 16)
+				rf64DataSize = readLittleEndian<quint64>(ds64, 8);
+		}
+		else if (id == "fmt " && size >= 16)
+		{
+			format.fmtChunk = file.read(size);
+			if (format.fmtChunk.size() < 16)
+				break;
+
+			formatTag = readLittleEndian<quint16>(format.fmtChunk, 0);
+			format.channelCount = readLittleEndian<quint16>(format.fmtChunk, 2);
+			format.sampleRate = static_cast<int>(readLittleEndian<quint32>(format.fmtChunk, 4));
+			format.bitsPerSample = readLittleEndian<quint16>(format.fmtChunk, 14);
+			// The sub-format GUID starts with the format tag
+			if (formatTag == FormatExtensible && size >= 26)
+				formatTag = readLittleEndian<quint16>(format.fmtChunk, 24);
+		}
+		else if (id == "data")
+		{
+			format.dataOffset = start;
+			dataSize = isRf64 && size == Rf64Size && rf64DataSize ? *rf64DataSize : size;
+			break;
+		}
+
+		// Chunks are padded to an even size
+		if (!file.seek(start + size + (size & 1)))
+			break;
+	}
+
+	if (format.fmtChunk.isEmpty() || !dataSize)
+		return std::unexpected("Missing fmt or data chunk in " + file.fileName());
+
+	format.isFloat = formatTag == FormatFloat;
+	const bool supportedInteger = formatTag == FormatPcm && (format.bitsPerSample == 8 || format.bitsPerSample == 16 || format.bitsPerSample == 24 || format.bitsPerSample == 32);
+	const bool supportedFloat = format.isFloat && (format.bitsPerSample == 32 || format.bitsPerSample == 64);
+	if (!(supportedInteger || supportedFloat) || format.channelCount <= 0 || format.sampleRate <= 0)
+		return std::unexpected(QString("Unsupported WAV format (tag %1, %2 bits) in %3").arg(formatTag).arg(format.bitsPerSample).arg(file.fileName()));
+
+	// Streaming writers leave the size at its maximum, the data then goes to the end of the file
+	const qint64 availableSize = std::min<quint64>(*dataSize, static_cast<quint64>(std::max<qint64>(0, file.size() - format.dataOffset)));
+	format.frameCount = availableSize / format.bytesPerFrame();
+	return format;
+}
+
+QByteArray makeHeader(const WavFormat& format)
+{
+	const quint64 dataSize = static_cast<quint64>(format.frameCount * format.bytesPerFrame());
+	const quint64 fmtSize = static_cast<quint64>(format.fmtChunk.size());
+	const quint64 fmtChunkSize = 8 + fmtSize + (fmtSize & 1);
+	const quint64 riffSize = 4 + fmtChunkSize + 8 + dataSize + (dataSize & 1);
+	const bool isRf64 = riffSize > Rf64Size;
+
+	QByteArray header;
+	header += isRf64 ? "RF64" : "RIFF";
+	appendLittleEndian<quint32>(header, isRf64 ? Rf64Size : static_cast<quint32>(riffSize));
+	header += "WAVE";
+
+	if (isRf64)
+	{
+		header += "ds64";
+		appendLittleEndian<quint32>(header, 28);
+		appendLittleEndian<quint64>(header, riffSize + 36);
+		appendLittleEndian<quint64>(header, dataSize);
+		appendLittleEndian<quint64>(header, static_cast<quint64>(format.frameCount));
+		appendLittleEndian<quint32>(header, 0); // No table entries
+	}
+
+	header += "fmt ";
+	appendLittleEndian<quint32>(header, static_cast<quint32>(fmtSize));
+	header += format.fmtChunk;
+	if (fmtSize & 1)
+		header += '\0';
+
+	header += "data";
+	appendLittleEndian<quint32>(header, isRf64 ? Rf64Size : static_cast<quint32>(dataSize));
+	return header;
+}
+
+inline qint32 readInt24(const char* bytes)
+{
+	const auto byte = [bytes](int i) { return static_cast<quint32>(static_cast<uchar>(bytes[i])); };
+	return static_cast<qint32>(byte(0) << 8 | byte(1) << 16 | byte(2) << 24) >> 8; // Sign-extended
+}
+
+inline void writeInt24(qint32 value, char* bytes)
+{
+	bytes[0] = static_cast<char>(value & 0xFF);
+	bytes[1] = static_cast<char>((value >> 8) & 0xFF);
+	bytes[2] = static_cast<char>((value >> 16) & 0xFF);
+}
+
+template<typename T>
+T toInteger(double sample, double scale)
+{
+	return static_cast<T>(std::lround(std::clamp(sample * scale, -scale, scale - 1.0)));
+}
+
+// Integer samples are scaled to [-1, 1). The format is switched on once per block, not per sample.
+void decode(const WavFormat& format, const char* bytes, double* samples, size_t count)
+{
+	const auto convert = [&](size_t sampleSize, auto toDouble) {
+		for (size_t i = 0; i < count; ++i)
+			samples[i] = toDouble(bytes + i * sampleSize);
+	};
+
+	switch (format.bitsPerSample)
+	{
+	case 8: // Unsigned
+		convert(1, [](const char* b) { return (static_cast<int>(static_cast<uchar>(*b)) - 128) / 128.0; });
+		break;
+	case 16:
+		convert(2, [](const char* b) { return qFromLittleEndian<qint16>(b) / 32768.0; });
+		break;
+	case 24:
+		convert(3, [](const char* b) { return readInt24(b) / 8388608.0; });
+		break;
+	case 32:
+		if (format.isFloat)
+			convert(4, [](const char* b) { return static_cast<double>(qFromLittleEndian<float>(b)); });
+		else
+			convert(4, [](const char* b) { return qFromLittleEndian<qint32>(b) / 2147483648.0; });
+		break;
+	default:
+		convert(8, [](const char* b) { return qFromLittleEndian<double>(b); });
+		break;
+	}
+}
+
+void encode(const WavFormat& format, const double* samples, char* bytes, size_t count)
+{
+	const auto convert = [&](size_t sampleSize, auto fromDouble) {
+		for (size_t i = 0; i < count; ++i)
+			fromDouble(samples[i], bytes + i * sampleSize);
+	};
+
+	switch (format.bitsPerSample)
+	{
+	case 8:
+		convert(1, [](double x, char* b) { *b = static_cast<char>(toInteger<int>(x, 128.0) + 128); });
+		break;
+	case 16:
+		convert(2, [](double x, char* b) { qToLittleEndian<qint16>(toInteger<qint16>(x, 32768.0), b); });
+		break;
+	case 24:
+		convert(3, [](double x, char* b) { writeInt24(toInteger<qint32>(x, 8388608.0), b); });
+		break;
+	case 32:
+		if (format.isFloat)
+			convert(4, [](double x, char* b) { qToLittleEndian<float>(static_cast<float>(x), b); });
+		else
+			convert(4, [](double x, char* b) { qToLittleEndian<qint32>(toInteger<qint32>(x, 2147483648.0), b); });
+		break;
+	default:
+		convert(8, [](double x, char* b) { qToLittleEndian<double>(x, b); });
+		break;
+	}
+}
+
+struct Block {
+	std::vector<char> bytes;
+	std::vector<double> samples;
+	qint64 frameCount = 0; // 0 ends the stream
+};
+
+} // namespace
+
+std::expected<WavRenderer::Result, QString> WavRenderer::render(const QString& inputPath, const QString& outputPath, const FilterList& filters)
+{
+	return render(inputPath, outputPath, [&filters](int sampleRate, int channelCount) -> Processor {
+		return [cascade = BiquadCascade(FilterBank::fromFilters(filters, sampleRate), static_cast<size_t>(channelCount))](double* samples, size_t frameCount) mutable {
+			cascade.process(samples, frameCount);
+		};
+	});
+}
+
+std::expected<WavRenderer::Result, QString> WavRenderer::render(const QString& inputPath, const QString& outputPath, const ProcessorFactory& createProcessor)
+{
+	QFile input(inputPath);
+	if (!input.open(QIODevice::ReadOnly))
+		return std::unexpected("Failed to open file for reading: " + inputPath);
+
+	const auto format = readHeader(input);
+	if (!format)
+		return std::unexpected(format.error());
+	if (!input.seek(format->dataOffset))
+		return std::unexpected("Error reading file: " + input.errorString());
+
+	const bool discardOutput = outputPath.isEmpty();
+	QSaveFile output(outputPath);
+	if (!discardOutput)
+	{
+		if (!output.open(QIODevice::WriteOnly))
+			return std::unexpected("Failed to open file for writing: " + outputPath);
+
+		const QByteArray header = makeHeader(*format);
+		if (output.write(header) != header.size())
+			return std::unexpected("Error writing file: " + output.errorString());
+	}
+
+	const auto channelCount = static_cast<size_t>(format->channelCount);
+	const Processor process = createProcessor(format->sampleRate, format->channelCount);
+
+	std::array<Block, BlockCount> blocks;
+	for (Block& block : blocks)
+	{
+		block.bytes.resize(static_cast<size_t>(BlockFrames * format->bytesPerFrame()));
+		block.samples.resize(static_cast<size_t>(BlockFrames) * channelCount);
+	}
+
+	// The blocks go round the ring through the three stages in order, each semaphore counts the blocks ready for a stage.
+	// A failing stage keeps passing the blocks on so that the others can't get stuck waiting for them.
+	std::counting_semaphore<BlockCount> readBlocks(0);
+	std::counting_semaphore<BlockCount> filteredBlocks(0);
+	std::counting_semaphore<BlockCount> freeBlocks(BlockCount);
+	std::atomic<bool> failed = false;
+	QString readError;
+	QString writeError;
+
+	{
+		std::jthread reader([&] {
+			qint64 remaining = format->frameCount;
+			for (size_t slot = 0;; slot = (slot + 1) % BlockCount)
+			{
+				freeBlocks.acquire();
+				Block& block = blocks[slot];
+				block.frameCount = failed ? 0 : std::min(remaining, BlockFrames);
+
+				const qint64 size = block.frameCount * format->bytesPerFrame();
+				if (size > 0 && input.read(block.bytes.data(), size) != size)
+				{
+					readError = "Error reading file: " + input.errorString();
+					failed = true;
+					block.frameCount = 0;
+				}
+				remaining -= block.frameCount;
+
+				const bool end = block.frameCount == 0;
+				readBlocks.release();
+				if (end)
+					return;
+			}
+		});
+
+		std::jthread writer([&] {
+			for (size_t slot = 0;; slot = (slot + 1) % BlockCount)
+			{
+				filteredBlocks.acquire();
+				const Block& block = blocks[slot];
+				const qint64 size = block.frameCount * format->bytesPerFrame();
+				if (size == 0)
+					return;
+
+				if (!failed && !discardOutput && output.write(block.bytes.data(), size) != size)
+				{
+					writeError = "Error writing file: " + output.errorString();
+					failed = true;
+				}
+				freeBlocks.release();
+			}
+		});
+
+		// Filtering on this thread
+		for (size_t slot = 0;; slot = (slot + 1) % BlockCount)
+		{
+			readBlocks.acquire();
+			Block& block = blocks[slot];
+			const bool end = block.frameCount == 0;
+			if (!end && !failed)
+			{
+				const size_t count = static_cast<size_t>(block.frameCount) * channelCount;
+				decode(*format, block.bytes.data(), block.samples.data(), count);
+				process(block.samples.data(), static_cast<size_t>(block.frameCount));
+				encode(*format, block.samples.data(), block.bytes.data(), count);
+			}
+
+			filteredBlocks.release();
+			if (end)
+				break;
+		}
+	}
+
+	if (failed)
+	{
+		if (!discardOutput)
+			output.cancelWriting();
+		return std::unexpected(!readError.isEmpty() ? readError : writeError);
+	}
+
+	if (discardOutput)
+		return Result{ format->frameCount, format->sampleRate, format->channelCount };
+
+	const qint64 dataSize = format->frameCount * format->bytesPerFrame();
+	if ((dataSize & 1) && output.write("\0", 1) != 1)
+		return std::unexpected("Error writing file: " + output.errorString());
+	if (!output.commit())
+		return std::unexpected("Error writing file: " + output.errorString());
+
+	return Result{ format->frameCount, format->sampleRate, format->channelCount };
+}
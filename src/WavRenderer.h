@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Filter.h"
+
+#include <QString>
+
+#include <expected>
+#include <functional>
+
+// Applies a filter chain to WAV files without loading them in memory, so that a profile can be listened to
+// or measured without going through Equalizer APO. Reading, filtering and writing run concurrently on
+// a few fixed-size blocks, the memory use doesn't depend on the file length.
+class WavRenderer final {
+public:
+	struct Result {
+		qint64 frameCount = 0;
+		int sampleRate = 0;
+		int channelCount = 0;
+	};
+
+	// Filters interleaved frames in place, the blocks are passed in order
+	using Processor = std::function<void(double* samples, size_t frameCount)>;
+	// Called once the format of the input is known
+	using ProcessorFactory = std::function<Processor(int sampleRate, int channelCount)>;
+
+	// 8 to 32-bit integer and 32 or 64-bit float PCM, RIFF or RF64. The output has the format of the input,
+	// integer samples are rounded and clipped. The output file is only replaced if the whole render succeeds.
+	[[nodiscard]] static std::expected<Result, QString> render(const QString& inputPath, const QString& outputPath, const FilterList& filters);
+	// With an empty output path the output is discarded, which measures the processing alone
+	[[nodiscard]] static std::expected<Result, QString> render(const QString& inputPath, const QString& outputPath, const ProcessorFactory& createProcessor);
+};
@@ -1,9 +1,221 @@
 #include "MainWindow.h"
+#include "PeakingFitter.h"
+#include "ProfileParser.h"
+#include "RealtimeEngine.h"
+#include "WavRenderer.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <variant>
+
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// A typical WASAPI shared mode period, 10 ms at 48 kHz
+inline constexpr size_t CallbackFrames = 480;
+
+static void printTimingStats(QTextStream& out, const RealtimeEngine::TimingStats& stats, double callbackMs)
+{
+	out << QString("Callback cost over %1 callbacks of %2 frames (%3 ms of audio each):\n").arg(stats.blockCount).arg(CallbackFrames).arg(callbackMs, 0, 'f', 2);
+	for (size_t b = 0; b < stats.histogram.size(); ++b)
+	{
+		if (stats.histogram[b] == 0)
+			continue;
+
+		const QString range = b == 0 ? QString("< 1 us") : QString("%1-%2 us").arg(1ull << (b - 1)).arg(1ull << b);
+		out << QString("  %1: %2\n").arg(range, 14).arg(stats.histogram[b]);
+	}
+	out << QString("  worst: %1 us\n").arg(stats.worstNanoseconds / 1000.0, 0, 'f', 1);
+}
+
+// The filters with their gains multiplied by scale, into a list of the same size so that it isn't reallocated
+static void scaleGains(const FilterList& filters, double scale, FilterList& scaled)
+{
+	scaled = filters;
+	for (Filter& filter : scaled)
+	{
+		std::visit([scale](auto& f) {
+			if constexpr (requires { f.setGain(0.0); })
+				f.setGain(f.gain() * scale);
+		}, filter);
+	}
+}
+
+static void attachParentConsole()
+{
+#ifdef Q_OS_WIN
+	// A GUI subsystem application has no console of its own, print to the one it has been started from
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* stream = nullptr;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+	}
+#endif
+}
+
+// EqApoGui --render <profile> [--realtime [--sweep]] <input.wav> <output.wav | ->
+static int renderFromCommandLine()
+{
+	attachParentConsole();
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Applies an Equalizer APO profile to a WAV file.");
+	parser.addHelpOption();
+	const QCommandLineOption renderOption("render", "Render <profile> and exit.", "profile");
+	parser.addOption(renderOption);
+	const QCommandLineOption realtimeOption("realtime", "Filter in audio callback sized blocks through the real-time engine and print the cost of the callbacks.");
+	parser.addOption(realtimeOption);
+	const QCommandLineOption sweepOption("sweep", "With --realtime, sweep the gains of the filters between 0 dB and their value once a second, "
+		"sending the changes every callback like a dragged slider, to time the callbacks that ramp the coefficients.");
+	parser.addOption(sweepOption);
+	parser.addPositionalArgument("input", "The WAV file to filter.");
+	parser.addPositionalArgument("output", "The filtered WAV file, in the format of the input, or - to discard it.");
+	parser.process(*QCoreApplication::instance());
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	const QStringList files = parser.positionalArguments();
+	if (files.size() != 2)
+	{
+		err << "Expected an input and an output file\n\n" << parser.helpText();
+		return 2;
+	}
+
+	const auto profile = ProfileParser::parseProfile(parser.value(renderOption));
+	if (!profile)
+	{
+		err << profile.error() << '\n';
+		return 1;
+	}
+
+	const QString outputPath = files[1] == "-" ? QString() : files[1];
+
+	QElapsedTimer timer;
+	timer.start();
+	std::shared_ptr<RealtimeEngine> engine;
+	const auto result = !parser.isSet(realtimeOption)
+		? WavRenderer::render(files[0], outputPath, profile->filters)
+		: WavRenderer::render(files[0], outputPath, [&](int sampleRate, int channelCount) -> WavRenderer::Processor {
+			engine = std::make_shared<RealtimeEngine>(sampleRate, static_cast<size_t>(channelCount));
+			if (!engine->setFilters(profile->filters))
+				err << "The profile has more filters than the engine, the last ones are left out\n";
+
+			return [engine, channels = static_cast<size_t>(channelCount), sampleRate, sweep = parser.isSet(sweepOption), filters = profile->filters,
+				swept = FilterList(), callback = uint64_t(0)](double* samples, size_t frameCount) mutable {
+				for (size_t first = 0; first < frameCount; first += CallbackFrames, ++callback)
+				{
+					if (sweep)
+					{
+						// Raised cosine, from the gains of the profile down to 0 dB and back every second
+						const double position = static_cast<double>(callback * CallbackFrames) / sampleRate;
+						scaleGains(filters, 0.5 + 0.5 * std::cos(2.0 * M_PI * position), swept);
+						(void)engine->setFilters(swept); // Whatever doesn't fit in the queue is sent with the next callback
+					}
+
+					engine->process(samples + first * channels, std::min(CallbackFrames, frameCount - first));
+				}
+			};
+		});
+	if (!result)
+	{
+		err << result.error() << '\n';
+		return 1;
+	}
+
+	const double seconds = static_cast<double>(result->frameCount) / result->sampleRate;
+	const double elapsed = std::max<qint64>(1, timer.elapsed()) / 1000.0;
+	out << QString("Rendered %1 s of %2-channel audio in %3 s (%4x real time)\n")
+		.arg(seconds, 0, 'f', 1)
+		.arg(result->channelCount)
+		.arg(elapsed, 0, 'f', 2)
+		.arg(seconds / elapsed, 0, 'f', 0);
+
+	if (engine)
+		printTimingStats(out, engine->timingStats(), 1000.0 * CallbackFrames / result->sampleRate);
+
+	return 0;
+}
+
+// EqApoGui --fit <curve> [--filters <count>] <profile>
+static int fitFromCommandLine()
+{
+	attachParentConsole();
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Fits peaking filters to a target curve and writes them as an Equalizer APO profile.");
+	parser.addHelpOption();
+	const QCommandLineOption fitOption("fit", "Fit to <curve>, \"<frequency> <dB>\" lines, and exit.", "curve");
+	parser.addOption(fitOption);
+	const QCommandLineOption filtersOption("filters", "The number of peaking filters, 10 by default.", "count", "10");
+	parser.addOption(filtersOption);
+	parser.addPositionalArgument("profile", "The profile to write, replaced if it exists.");
+	parser.process(*QCoreApplication::instance());
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	const QStringList files = parser.positionalArguments();
+	bool countOk = false;
+	const int filterCount = parser.value(filtersOption).toInt(&countOk);
+	if (files.size() != 1 || !countOk || filterCount < 1)
+	{
+		err << "Expected a filter count and an output profile\n\n" << parser.helpText();
+		return 2;
+	}
+
+	const auto curve = PeakingFitter::readCurve(parser.value(fitOption));
+	if (!curve)
+	{
+		err << curve.error() << '\n';
+		return 1;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	PeakingFitter::Options options;
+	options.filterCount = static_cast<size_t>(filterCount);
+	const auto result = PeakingFitter::fit(curve->grid, curve->db, options);
+	if (!result)
+	{
+		err << result.error() << '\n';
+		return 1;
+	}
+
+	const qint64 elapsed = timer.elapsed();
+	if (auto saved = ProfileParser::saveProfile(files[0], result->filters); !saved)
+	{
+		err << saved.error() << '\n';
+		return 1;
+	}
+
+	out << QString("Fitted %1 filters in %2 ms, RMS error %3 dB\n").arg(filterCount).arg(elapsed).arg(result->rmsErrorDb, 0, 'f', 2);
+	return 0;
+}
 
 int main(int argc, char* argv[])
 {
+	// Headless, no window is created
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view argument(argv[i]);
+		if (argument.starts_with("--render") || argument.starts_with("--fit"))
+		{
+			QCoreApplication app(argc, argv);
+			return argument.starts_with("--render") ? renderFromCommandLine() : fitFromCommandLine();
+		}
+	}
+
 	QApplication app(argc, argv);
 	MainWindow w;
 	w.show();
@@ -0,0 +1,21 @@
+QT = core testlib
+
+CONFIG += c++latest testcase console
+CONFIG -= app_bundle
+
+msvc*{
+	QMAKE_CXXFLAGS += /MP
+	QMAKE_CXXFLAGS_WARN_ON = /W4
+}
+
+INCLUDEPATH += ../src
+
+SOURCES += \
+	tst_includeresolver.cpp \
+	../src/ConfigDocument.cpp \
+	../src/Filter.cpp \
+	../src/FrequencyResponse.cpp \
+	../src/IncludeResolver.cpp \
+	../src/ProfileCache.cpp \
+	../src/ProfileParser.cpp \
+	../src/ProfileScanner.cpp
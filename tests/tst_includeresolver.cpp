@@ -0,0 +1,49 @@
+#include "IncludeResolver.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <variant>
+
+class IncludeResolverTest final : public QObject {
+	Q_OBJECT
+
+private slots:
+	void numberedFilterLines();
+};
+
+void IncludeResolverTest::numberedFilterLines()
+{
+	QTemporaryDir folder;
+	QVERIFY(folder.isValid());
+
+	// As written by AutoEq, every filter line is numbered
+	QFile profile(folder.filePath("profile.txt"));
+	QVERIFY(profile.open(QIODevice::WriteOnly));
+	profile.write(
+		"Preamp: -3 dB\r\n"
+		"Filter 1: ON PK Fc 105 Hz Gain -3 dB Q 0.7\r\n"
+		"Filter 2: ON LP Fc 15000 Hz\r\n"
+		"Filter 3: OFF PK Fc 1000 Hz Gain 2 dB Q 1\r\n");
+	profile.close();
+
+	IncludeResolver resolver;
+	const IncludeResolver::Result result = resolver.resolve(folder.filePath("config.txt"), "Preamp: -6 dB\r\nInclude: profile.txt\r\n");
+
+	QVERIFY2(result.errors.isEmpty(), qPrintable(result.errors.join('\n')));
+	QCOMPARE(result.filePaths.size(), 2);
+
+	// The disabled filter is left out
+	const FilterList& filters = result.filters.filters;
+	QCOMPARE(filters.size(), size_t(4));
+	QCOMPARE(std::get<PreampFilter>(filters[0]).gain(), -6.0);
+	QCOMPARE(std::get<PreampFilter>(filters[1]).gain(), -3.0);
+	QCOMPARE(std::get<PeakingFilter>(filters[2]).fc(), 105.0);
+	QCOMPARE(std::get<PeakingFilter>(filters[2]).gain(), -3.0);
+	QVERIFY(std::holds_alternative<LowPassFilter>(filters[3]));
+}
+
+QTEST_APPLESS_MAIN(IncludeResolverTest)
+
+#include "tst_includeresolver.moc"